@@ -0,0 +1,111 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include "../include/includes.h"
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+// How the time sent to shaders is kept small enough for a float uniform
+enum class TimeWrap {
+    None,       // Unbounded, precision drops as it grows
+    Wrap,       // Modulo the period
+    Rebase      // Restart from zero at the period
+};
+
+// Time base on the 64-bit performance counter. Elapsed time is accumulated as a
+// double (exact for days); only the value sent to shaders is wrapped and narrowed.
+class FrameClock {
+public:
+    FrameClock() {
+        secondsPerTick = 1.0 / SDL_GetPerformanceFrequency();
+        lastCounter = SDL_GetPerformanceCounter();
+    }
+
+    void configure(TimeWrap mode, double periodSeconds) {
+        wrapMode = periodSeconds > 0.0 ? mode : TimeWrap::None;
+        period = periodSeconds;
+        rebaseOrigin = time;
+    }
+
+    // Advance to now, returns the (scaled) frame delta in seconds
+    double tick() {
+        Uint64 counter = SDL_GetPerformanceCounter();
+        double elapsed = (counter - lastCounter) * secondsPerTick;
+        lastCounter = counter;
+
+        if (paused) {
+            delta = pendingStep;
+            pendingStep = 0.0;
+        } else {
+            delta = elapsed * scale;
+        }
+        time += delta;
+
+        if (wrapMode == TimeWrap::Rebase && time - rebaseOrigin >= period) {
+            rebaseOrigin = time;
+        }
+        return delta;
+    }
+
+    double getTime() const { return time; }
+
+    // Time for the shader after wrapping / rebasing
+    double getShaderTime() const {
+        if (wrapMode == TimeWrap::Wrap) {
+            return std::fmod(time, period);
+        }
+        if (wrapMode == TimeWrap::Rebase) {
+            return time - rebaseOrigin;
+        }
+        return time;
+    }
+
+    void setPaused(bool value) {
+        paused = value;
+        pendingStep = 0.0;
+    }
+    bool isPaused() const { return paused; }
+
+    void setScale(double value) { scale = value > 0.0 ? value : 0.0; }
+    double getScale() const { return scale; }
+
+    // Advance a paused clock on the next tick
+    void step(double seconds) {
+        if (paused) {
+            pendingStep += seconds;
+        }
+    }
+
+private:
+    TimeWrap wrapMode = TimeWrap::None;
+    double period = 0.0;
+    double secondsPerTick = 0.0;
+    Uint64 lastCounter = 0;
+    double time = 0.0;
+    double delta = 0.0;
+    double rebaseOrigin = 0.0;
+    bool paused = false;
+    double scale = 1.0;
+    double pendingStep = 0.0;
+};
+
+// iDate: year, month (0-11), day, seconds since local midnight
+void getShaderToyDate(float date[4]) {
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    double fraction = std::chrono::duration<double>(now.time_since_epoch()).count() - static_cast<double>(seconds);
+
+    date[0] = static_cast<float>(local.tm_year + 1900);
+    date[1] = static_cast<float>(local.tm_mon);
+    date[2] = static_cast<float>(local.tm_mday);
+    date[3] = static_cast<float>(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec + fraction);
+}
+
+#endif // FRAME_CLOCK_H
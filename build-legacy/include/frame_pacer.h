@@ -0,0 +1,136 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "../include/includes.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Swap synchronisation modes
+enum class SwapMode {
+    VSync,          // Swap on vertical blank
+    AdaptiveVSync,  // Swap on vertical blank, tear instead of waiting when late
+    FreeRunning     // Swap immediately
+};
+
+const char* getSwapModeName(SwapMode mode) {
+    switch (mode) {
+        case SwapMode::VSync: return "vsync";
+        case SwapMode::AdaptiveVSync: return "adaptive vsync";
+        case SwapMode::FreeRunning: return "free running";
+    }
+    return "unknown";
+}
+
+// Frame pacing on the performance counter: swap interval for vsync / adaptive / free
+// running, plus an optional limiter that sleeps until just before the deadline and
+// spins the rest (SDL_Delay alone overshoots by a scheduler tick)
+class FramePacer {
+public:
+    FramePacer() : intervals(HISTORY_SIZE, 0.0) {
+        tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+    }
+
+    // Returns false if the driver rejected the swap interval
+    bool setSwapMode(SwapMode mode) {
+        int interval = (mode == SwapMode::AdaptiveVSync) ? -1 : (mode == SwapMode::FreeRunning ? 0 : 1);
+        if (SDL_GL_SetSwapInterval(interval) != 0) {
+            if (mode == SwapMode::AdaptiveVSync && SDL_GL_SetSwapInterval(1) == 0) {
+                std::cerr << "Adaptive vsync not supported, using vsync" << std::endl;
+                mode = SwapMode::VSync;
+            } else {
+                std::cerr << "Could not set swap interval " << interval << ": " << SDL_GetError() << std::endl;
+                return false;
+            }
+        }
+        swapMode = mode;
+        return true;
+    }
+
+    SwapMode getSwapMode() const { return swapMode; }
+
+    // Frames per second for the limiter, 0 turns it off
+    void setTargetRate(double framesPerSecond) {
+        targetRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+        period = targetRate > 0.0 ? static_cast<Uint64>(SDL_GetPerformanceFrequency() / targetRate) : 0;
+        deadline = SDL_GetPerformanceCounter() + period;
+    }
+
+    // Call once per frame after SDL_GL_SwapWindow
+    void wait() {
+        if (period > 0) {
+            Uint64 now = SDL_GetPerformanceCounter();
+
+            // Way behind (stall): restart the schedule instead of catching up
+            if (now > deadline + period) {
+                deadline = now;
+            }
+
+            double remainingMs = (static_cast<double>(deadline) - static_cast<double>(now)) * tickMs;
+            if (remainingMs > SPIN_MARGIN_MS) {
+                SDL_Delay(static_cast<Uint32>(remainingMs - SPIN_MARGIN_MS));
+            }
+            while (SDL_GetPerformanceCounter() < deadline) {
+                std::this_thread::yield();
+            }
+            deadline += period;
+        }
+
+        // First call just starts the clock
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (lastFrame != 0) {
+            intervals[next] = (now - lastFrame) * tickMs;
+            next = (next + 1) % HISTORY_SIZE;
+            if (count < HISTORY_SIZE) {
+                count++;
+            }
+        }
+        lastFrame = now;
+    }
+
+    // Mean, jitter (standard deviation), min, p99 and max of the recent frame intervals
+    void printStats() const {
+        if (count == 0) {
+            std::cout << "Frame pacing: no frames yet" << std::endl;
+            return;
+        }
+
+        std::vector<double> sorted(intervals.begin(), intervals.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double interval : sorted) {
+            mean += interval;
+        }
+        mean /= count;
+        double variance = 0.0;
+        for (double interval : sorted) {
+            variance += (interval - mean) * (interval - mean);
+        }
+        double p99 = sorted[std::max(static_cast<int>(std::ceil(0.99 * count)), 1) - 1];
+
+        std::cout << "Frame pacing (" << getSwapModeName(swapMode);
+        if (targetRate > 0.0) {
+            std::cout << ", limited to " << targetRate << " fps";
+        }
+        std::cout << "): mean " << mean << " ms, jitter " << std::sqrt(variance / count) << " ms, min "
+                  << sorted.front() << " ms, p99 " << p99 << " ms, max " << sorted.back() << " ms over "
+                  << count << " frames" << std::endl;
+    }
+
+private:
+    static const int HISTORY_SIZE = 240;
+    static const int SPIN_MARGIN_MS = 2;
+
+    SwapMode swapMode = SwapMode::VSync;
+    double targetRate = 0.0;
+    double tickMs = 0.0;
+    Uint64 period = 0;
+    Uint64 deadline = 0;
+    Uint64 lastFrame = 0;
+    std::vector<double> intervals;
+    int next = 0;
+    int count = 0;
+};
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,95 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+
+#include "../include/includes.h"
+#include "../include/spsc_queue.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Command from the event thread to the render thread
+struct InputCommand {
+    enum Type { Quit, Key, Resize };
+
+    Type type = Quit;
+    SDL_Keycode key = 0;
+    int width = 0;          // New window size for Resize
+    int height = 0;
+    Uint32 timestamp = 0;   // SDL event time (ms), for input latency
+};
+
+typedef SpscQueue<InputCommand, 64> InputQueue;
+
+// Turn pending SDL events into commands, waiting up to waitMs for the first one.
+// Returns false once a quit has been queued.
+bool pumpEvents(InputQueue& queue, int waitMs) {
+    SDL_Event e;
+    bool running = true;
+    bool haveEvent = waitMs > 0 ? SDL_WaitEventTimeout(&e, waitMs) != 0 : SDL_PollEvent(&e) != 0;
+
+    while (haveEvent) {
+        InputCommand command;
+        command.timestamp = e.common.timestamp;
+        bool send = true;
+
+        if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
+            command.type = InputCommand::Quit;
+            running = false;
+        } else if (e.type == SDL_KEYDOWN) {
+            command.type = InputCommand::Key;
+            command.key = e.key.keysym.sym;
+        } else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
+            command.type = InputCommand::Resize;
+            command.width = e.window.data1;
+            command.height = e.window.data2;
+        } else {
+            send = false;
+        }
+
+        // The queue only fills up if the render thread stalls; wait for room
+        while (send && !queue.push(command)) {
+            SDL_Delay(1);
+        }
+        haveEvent = SDL_PollEvent(&e) != 0;
+    }
+    return running;
+}
+
+// Event-to-present latency of key presses
+class InputLatency {
+public:
+    InputLatency() : samples(HISTORY_SIZE, 0.0) {}
+
+    void record(Uint32 eventTimestamp) {
+        samples[next] = static_cast<double>(SDL_GetTicks() - eventTimestamp);
+        next = (next + 1) % HISTORY_SIZE;
+        if (count < HISTORY_SIZE) {
+            count++;
+        }
+    }
+
+    void print() const {
+        if (count == 0) {
+            std::cout << "Input latency: no input yet" << std::endl;
+            return;
+        }
+        std::vector<double> sorted(samples.begin(), samples.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double sample : sorted) {
+            total += sample;
+        }
+        double p95 = sorted[std::max(static_cast<int>(std::ceil(0.95 * count)), 1) - 1];
+        std::cout << "Input latency (event to present): mean " << total / count << " ms, p50 " << sorted[(count - 1) / 2]
+                  << " ms, p95 " << p95 << " ms, max " << sorted.back() << " ms over " << count << " events" << std::endl;
+    }
+
+private:
+    static const int HISTORY_SIZE = 256;
+
+    std::vector<double> samples;
+    int next = 0;
+    int count = 0;
+};
+
+#endif // INPUT_EVENTS_H
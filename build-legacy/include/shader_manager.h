@@ -3,6 +3,12 @@
 
 #include "../include/includes.h"
 #include "../include/utils.h"
+#include "../include/frame_pacer.h"
+#include "../include/frame_clock.h"
+#include "../include/input_events.h"
+#include <atomic>
+#include <map>
+#include <thread>
 
 // Window dimensions - changed to variables instead of constants
 int WINDOW_WIDTH = 1024;
@@ -11,9 +17,29 @@ int WINDOW_HEIGHT = 1024;
 // Default texture path
 std::string texturePath = "textures/stone.png";
 
-// Current shader paths
-std::string currentVertexPath = "shaders/shader1/vertex.glsl";
-std::string currentFragmentPath = "shaders/shader1/fragment.glsl";
+// Time sent as "millis" wraps so the float stays exact to the millisecond on renderers
+// that run for days (unwrapped it drifts after about 4.6 hours). The period is a whole
+// number of 2*pi seconds (about an hour) so the sin(millis / 1000.0) animations do not jump.
+TimeWrap timeWrapMode = TimeWrap::Wrap;
+double timeWrapSeconds = 573 * 6.283185307179586;
+
+// Render on its own thread while the main thread handles SDL events
+// (false renders and pumps events on one thread, e.g. to compare input latency)
+bool useRenderThread = true;
+
+// Current shader directory (holds vertex.glsl and fragment.glsl)
+std::string currentShaderDir = "shaders/shader1";
+
+// A linked program and the uniform locations the drawer sets every frame
+struct LegacyProgram {
+    GLuint program = 0;
+    GLint millisLoc = -1;
+    GLint backgroundLoc = -1;
+    GLint dateLoc = -1;
+};
+
+// Programs that linked successfully, by shader directory, so switching back is instant
+std::map<std::string, LegacyProgram> programCache;
 
 // Function to handle window resize
 void handleResize(int width, int height) {
@@ -35,26 +61,53 @@ GLuint loadShaders(const std::string& vertexPath, const std::string& fragmentPat
     return shaderProgram;
 }
 
-// Function to reload the current shader
-GLuint reloadCurrentShader(GLuint currentProgram) {
-    // Delete the current program
-    if (currentProgram != 0) {
-        glDeleteProgram(currentProgram);
+// Build the program of a shader directory next to whatever is live. program is 0 on failure.
+LegacyProgram buildProgram(const std::string& shaderDir) {
+    LegacyProgram result;
+    result.program = loadShaders(shaderDir + "/vertex.glsl", shaderDir + "/fragment.glsl");
+    if (result.program != 0) {
+        result.millisLoc = glGetUniformLocation(result.program, "millis");
+        result.backgroundLoc = glGetUniformLocation(result.program, "background");
+        result.dateLoc = glGetUniformLocation(result.program, "iDate");
     }
-    
-    // Load and compile the updated shader
-    std::cout << "Reloading shaders from: " << currentVertexPath << " and " << currentFragmentPath << std::endl;
-    GLuint newProgram = loadShaders(currentVertexPath, currentFragmentPath);
-    
-    if (newProgram == 0) {
+    return result;
+}
+
+// Switch to a shader directory: cached programs are used right away, others are built
+// first. Returns false (and changes nothing) if the shader does not compile.
+bool selectShader(const std::string& shaderDir, LegacyProgram& active) {
+    auto cached = programCache.find(shaderDir);
+    if (cached == programCache.end()) {
+        LegacyProgram built = buildProgram(shaderDir);
+        if (built.program == 0) {
+            std::cerr << "Cannot switch to " << shaderDir << ", keeping the current shader." << std::endl;
+            return false;
+        }
+        cached = programCache.insert(std::make_pair(shaderDir, built)).first;
+    }
+    currentShaderDir = shaderDir;
+    active = cached->second;
+    return true;
+}
+
+// Function to reload the current shader. The new program is built while the old one
+// stays live and only replaces it after linking, so a typo keeps the previous shader.
+bool reloadCurrentShader(LegacyProgram& active) {
+    std::cout << "Reloading shaders from: " << currentShaderDir << std::endl;
+    LegacyProgram rebuilt = buildProgram(currentShaderDir);
+    if (rebuilt.program == 0) {
         std::cerr << "Shader reload failed! Keeping previous shader." << std::endl;
-        // If reload fails, try to recreate the original shader
-        newProgram = loadShaders(currentVertexPath, currentFragmentPath);
-    } else {
-        std::cout << "Shader reloaded successfully!" << std::endl;
+        return false;
     }
     
-    return newProgram;
+    LegacyProgram& cached = programCache[currentShaderDir];
+    if (cached.program != 0) {
+        glDeleteProgram(cached.program);
+    }
+    cached = rebuilt;
+    active = rebuilt;
+    std::cout << "Shader reloaded successfully!" << std::endl;
+    return true;
 }
 
 // Function to load a texture from file
@@ -169,14 +222,24 @@ int drawer(int argc, char* argv[]) {
     }
     
     // Load initial shader program
-    GLuint shaderProgram = loadShaders(currentVertexPath, currentFragmentPath);
-    if (shaderProgram == 0) {
+    LegacyProgram activeProgram;
+    if (!selectShader(currentShaderDir, activeProgram)) {
         SDL_GL_DeleteContext(glContext);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return 1;
     }
     
+    // Build the other shaders up front so the first switch is instant as well
+    for (const std::string& shaderDir : { std::string("shaders/shader1"), std::string("shaders/shader2") }) {
+        if (programCache.find(shaderDir) == programCache.end()) {
+            LegacyProgram built = buildProgram(shaderDir);
+            if (built.program != 0) {
+                programCache[shaderDir] = built;
+            }
+        }
+    }
+    
     // Set up vertex data (a quad made of two triangles)
     float vertices[] = {
         // positions        // texture coords
@@ -208,134 +271,186 @@ int drawer(int argc, char* argv[]) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     
-    // Get attribute locations
-    GLint posAttrib = glGetAttribLocation(shaderProgram, "aPosition");
-    GLint texAttrib = glGetAttribLocation(shaderProgram, "aTexCoord");
-    
-    // Set vertex attribute pointers
+    // Set vertex attribute pointers (locations are bound at link time, see createShaderProgram)
     // Position attribute
-    glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(posAttrib);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(POSITION_ATTRIB);
     
     // Texture coordinate attribute
-    glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(texAttrib);
+    glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(TEXCOORD_ATTRIB);
     
     // Unbind VAO
     glBindVertexArray(0);
     
-    // Get the location of the uniforms
-    GLint millisLoc = glGetUniformLocation(shaderProgram, "millis");
-    GLint backgroundLoc = glGetUniformLocation(shaderProgram, "background");
-    
     // Initialize viewport
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     
-    // Main loop flag
-    bool quit = false;
-    SDL_Event e;
+    // Vsync by default; fall back to a 60 fps limiter when the driver refuses
+    FramePacer pacer;
+    if (!pacer.setSwapMode(SwapMode::VSync)) {
+        pacer.setTargetRate(60.0);
+    }
     
     // For timing
-    Uint32 startTime = SDL_GetTicks();
-    
-    // Main loop
-    while (!quit) {
-        // Handle events
-        while (SDL_PollEvent(&e) != 0) {
-            if (e.type == SDL_QUIT) {
-                quit = true;
+    FrameClock clock;
+    clock.configure(timeWrapMode, timeWrapSeconds);
+    
+    // Events arrive as commands through a lock-free queue
+    InputQueue inputQueue;
+    InputLatency inputLatency;
+    
+    auto renderLoop = [&]() {
+        bool quit = false;
+        while (!quit) {
+            // Single-threaded: pump events at the start of the frame
+            if (!useRenderThread) {
+                pumpEvents(inputQueue, 0);
             }
-            else if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_ESCAPE) {
+            
+            // Apply input, timing the oldest key press of the frame until its present
+            InputCommand command;
+            bool haveInput = false;
+            Uint32 oldestInput = 0;
+            while (inputQueue.pop(command)) {
+                if (command.type == InputCommand::Quit) {
                     quit = true;
-                }
-                else if (e.key.keysym.sym == SDLK_1) {
-                    // Switch to shader 1
-                    currentVertexPath = "shaders/shader1/vertex.glsl";
-                    currentFragmentPath = "shaders/shader1/fragment.glsl";
-                    shaderProgram = reloadCurrentShader(shaderProgram);
-                    // Get the uniform locations again after reloading
-                    millisLoc = glGetUniformLocation(shaderProgram, "millis");
-                    backgroundLoc = glGetUniformLocation(shaderProgram, "background");
-                }
-                else if (e.key.keysym.sym == SDLK_2) {
-                    // Switch to shader 2
-                    currentVertexPath = "shaders/shader2/vertex.glsl";
-                    currentFragmentPath = "shaders/shader2/fragment.glsl";
-                    shaderProgram = reloadCurrentShader(shaderProgram);
-                    // Get the uniform locations again after reloading
-                    millisLoc = glGetUniformLocation(shaderProgram, "millis");
-                    backgroundLoc = glGetUniformLocation(shaderProgram, "background");
-                }
-                else if (e.key.keysym.sym == SDLK_r) {
-                    // Reload current shader
-                    shaderProgram = reloadCurrentShader(shaderProgram);
-                    // Update attribute and uniform locations after reload
-                    posAttrib = glGetAttribLocation(shaderProgram, "aPosition");
-                    texAttrib = glGetAttribLocation(shaderProgram, "aTexCoord");
-                    millisLoc = glGetUniformLocation(shaderProgram, "millis");
-                    backgroundLoc = glGetUniformLocation(shaderProgram, "background");
-                    // Rebind VAO
-                    glBindVertexArray(VAO);
-                    // Update vertex attribute pointers
-                    glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-                    glEnableVertexAttribArray(posAttrib);
-                    glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-                    glEnableVertexAttribArray(texAttrib);
-                    // Unbind VAO
-                    glBindVertexArray(0);
+                } else if (command.type == InputCommand::Resize) {
+                    handleResize(command.width, command.height);
+                } else {
+                    if (!haveInput) {
+                        haveInput = true;
+                        oldestInput = command.timestamp;
+                    }
+                    if (command.key == SDLK_F3) {
+                        pacer.printStats();
+                        inputLatency.print();
+                    } else if (command.key == SDLK_1) {
+                        // Switch to shader 1 (compiled on first use, cached after that)
+                        selectShader("shaders/shader1", activeProgram);
+                    }
+                    else if (command.key == SDLK_2) {
+                        // Switch to shader 2
+                        selectShader("shaders/shader2", activeProgram);
+                    }
+                    else if (command.key == SDLK_F2) {
+                        // Cycle vsync -> adaptive vsync -> free running
+                        SwapMode nextMode = SwapMode::VSync;
+                        if (pacer.getSwapMode() == SwapMode::VSync) {
+                            nextMode = SwapMode::AdaptiveVSync;
+                        } else if (pacer.getSwapMode() == SwapMode::AdaptiveVSync) {
+                            nextMode = SwapMode::FreeRunning;
+                        }
+                        pacer.setSwapMode(nextMode);
+                        std::cout << "Swap mode: " << getSwapModeName(pacer.getSwapMode()) << std::endl;
+                    }
+                    else if (command.key == SDLK_F4) {
+                        // Pause / resume time
+                        clock.setPaused(!clock.isPaused());
+                        std::cout << (clock.isPaused() ? "Paused" : "Resumed") << std::endl;
+                    }
+                    else if (command.key == SDLK_F5) {
+                        // Step one frame while paused
+                        clock.step(1.0 / 60.0);
+                    }
+                    else if (command.key == SDLK_F6 || command.key == SDLK_F7 || command.key == SDLK_F8) {
+                        // Halve / double / reset time speed
+                        double scale = 1.0;
+                        if (command.key == SDLK_F6) {
+                            scale = clock.getScale() * 0.5;
+                        } else if (command.key == SDLK_F7) {
+                            scale = clock.getScale() * 2.0;
+                        }
+                        clock.setScale(scale);
+                        std::cout << "Time speed x" << clock.getScale() << std::endl;
+                    }
+                    else if (command.key == SDLK_r) {
+                        // Reload current shader (attribute locations are fixed, the VAO stays valid)
+                        reloadCurrentShader(activeProgram);
+                    }
                 }
             }
-            // Handle window resize event
-            else if (e.type == SDL_WINDOWEVENT) {
-                if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    // Handle window resize
-                    handleResize(e.window.data1, e.window.data2);
-                }
+            if (quit) {
+                break;
             }
-        }
+            
+            // Calculate elapsed time in milliseconds (wrapped before narrowing to float)
+            clock.tick();
+            float currentTime = static_cast<float>(clock.getShaderTime() * 1000.0);
         
-        // Calculate elapsed time in milliseconds
-        float currentTime = SDL_GetTicks() - startTime;
+            // Clear the screen
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
         
-        // Clear the screen
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+            // Use the shader program
+            glUseProgram(activeProgram.program);
         
-        // Use the shader program
-        glUseProgram(shaderProgram);
+            // Activate texture unit 0 and bind the background texture
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, backgroundTexture);
         
-        // Activate texture unit 0 and bind the background texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, backgroundTexture);
+            // Set the background uniform to use texture unit 0
+            if (activeProgram.backgroundLoc != -1) {
+                glUniform1i(activeProgram.backgroundLoc, 0);
+            }
         
-        // Set the background uniform to use texture unit 0
-        if (backgroundLoc != -1) {
-            glUniform1i(backgroundLoc, 0);
-        }
+            // Update the millis uniform
+            if (activeProgram.millisLoc != -1) {
+                glUniform1f(activeProgram.millisLoc, currentTime);
+            }
         
-        // Update the millis uniform
-        if (millisLoc != -1) {
-            glUniform1f(millisLoc, currentTime);
-        }
+            // Update the iDate uniform (year, month, day, seconds since midnight)
+            if (activeProgram.dateLoc != -1) {
+                float date[4];
+                getShaderToyDate(date);
+                glUniform4f(activeProgram.dateLoc, date[0], date[1], date[2], date[3]);
+            }
         
-        // Draw the quad
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+            // Draw the quad
+            glBindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
         
-        // Swap buffers
-        SDL_GL_SwapWindow(window);
+            // Swap buffers
+            SDL_GL_SwapWindow(window);
+            if (haveInput) {
+                inputLatency.record(oldestInput);
+            }
         
-        // Add a small delay to reduce CPU usage
-        SDL_Delay(16); // ~60 FPS
+            // Wait for the next frame deadline (no-op without a limiter)
+            pacer.wait();
+        }
+    };
+    
+    if (useRenderThread) {
+        // Render on a second thread; SDL wants events pumped where the window was created
+        SDL_GL_MakeCurrent(window, nullptr);
+        std::atomic<bool> rendering(true);
+        std::thread renderThread([&]() {
+            SDL_GL_MakeCurrent(window, glContext);
+            renderLoop();
+            SDL_GL_MakeCurrent(window, nullptr);
+            rendering = false;
+        });
+        while (rendering && pumpEvents(inputQueue, 10)) {
+        }
+        renderThread.join();
+        SDL_GL_MakeCurrent(window, glContext);
+    } else {
+        renderLoop();
     }
     
+    pacer.printStats();
+    inputLatency.print();
+    
     // Clean up
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    for (auto& cached : programCache) {
+        glDeleteProgram(cached.second.program);
+    }
+    programCache.clear();
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
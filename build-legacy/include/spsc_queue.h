@@ -0,0 +1,45 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Each index is written by one side only; release/acquire ordering on them publishes
+// the slot contents. One slot stays empty to tell full from empty.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer: false when the queue is full
+    bool push(const T& value) {
+        size_t current = tail.load(std::memory_order_relaxed);
+        size_t next = (current + 1) % (Capacity + 1);
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[current] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false when the queue is empty
+    bool pop(T& value) {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[current];
+        head.store((current + 1) % (Capacity + 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    T slots[Capacity + 1];
+    alignas(64) std::atomic<size_t> head;   // Next slot to read, owned by the consumer
+    alignas(64) std::atomic<size_t> tail;   // Next slot to write, owned by the producer
+};
+
+#endif // SPSC_QUEUE_H
@@ -59,8 +59,12 @@ std::string loadShaderFromFile(const std::string& filePath) {
     return shaderCode;
 }
 
-// Function to check shader compilation/linking errors
-void checkShaderError(GLuint shader, const std::string& type) {
+// Fixed attribute slots, bound before linking so every program works with the same VAO
+const GLuint POSITION_ATTRIB = 0;
+const GLuint TEXCOORD_ATTRIB = 1;
+
+// Function to check shader compilation/linking errors, returns true on success
+bool checkShaderError(GLuint shader, const std::string& type) {
     GLint success;
     GLchar infoLog[1024];
     
@@ -70,6 +74,7 @@ void checkShaderError(GLuint shader, const std::string& type) {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
             std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" 
                       << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            return false;
         }
     } else {
         glGetProgramiv(shader, GL_LINK_STATUS, &success);
@@ -77,8 +82,10 @@ void checkShaderError(GLuint shader, const std::string& type) {
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
             std::cerr << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" 
                       << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            return false;
         }
     }
+    return true;
 }
 
 // Function to create and compile a shader from file
@@ -102,7 +109,10 @@ GLuint createShaderFromFile(const std::string& filePath, GLenum shaderType) {
         case GL_FRAGMENT_SHADER: typeName = "FRAGMENT"; break;
         default: typeName = "UNKNOWN"; break;
     }
-    checkShaderError(shader, typeName);
+    if (!checkShaderError(shader, typeName)) {
+        glDeleteShader(shader);
+        return 0;
+    }
     
     return shader;
 }
@@ -114,6 +124,8 @@ GLuint createShaderProgram(const std::string& vertexPath, const std::string& fra
     GLuint fragmentShader = createShaderFromFile(fragmentPath, GL_FRAGMENT_SHADER);
     
     if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
         return 0;
     }
     
@@ -121,15 +133,20 @@ GLuint createShaderProgram(const std::string& vertexPath, const std::string& fra
     GLuint shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
+    glBindAttribLocation(shaderProgram, POSITION_ATTRIB, "aPosition");
+    glBindAttribLocation(shaderProgram, TEXCOORD_ATTRIB, "aTexCoord");
     glLinkProgram(shaderProgram);
     
-    // Check for linking errors
-    checkShaderError(shaderProgram, "PROGRAM");
-    
     // Delete shaders as they're linked into the program and no longer needed
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
     
+    // Check for linking errors, a program that failed to link is useless
+    if (!checkShaderError(shaderProgram, "PROGRAM")) {
+        glDeleteProgram(shaderProgram);
+        return 0;
+    }
+    
     return shaderProgram;
 }
 
@@ -3,8 +3,22 @@ rm -f shadertoy_renderer.exe
 sleep 0.5
 
 cd src
-g++ -o shadertoy_renderer main.cpp shader_manager.cpp shadertoy_utils.cpp -lmingw32 -lSDL2main -lSDL2 -lglew32 -lopengl32
+# Benchmark results are stored per build
+BUILD_ID=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
 
-sleep 1
+SOURCES="main.cpp shader_manager.cpp shadertoy_utils.cpp options.cpp headless_context.cpp program_cache.cpp uniform_buffer.cpp multipass.cpp texture_cache.cpp gpu_profiler.cpp frame_pacer.cpp frame_clock.cpp shader_watcher.cpp compile_worker.cpp input_events.cpp shader_registry.cpp frame_readback.cpp frame_encoder.cpp frame_capture.cpp tiled_renderer.cpp benchmark.cpp bench_store.cpp image_compare.cpp golden.cpp heatmap_overlay.cpp shader_cost.cpp render_target.cpp resolution_governor.cpp shader_loading.cpp headless_mode.cpp export_mode.cpp benchmark_mode.cpp golden_mode.cpp cost_mode.cpp"
 
-./shadertoy_renderer.exe
\ No newline at end of file
+if [ "$(uname -s)" = "Linux" ]; then
+    # Linux: also build the OSMesa backend so ./shadertoy_renderer --headless works without a display
+    g++ -o shadertoy_renderer $SOURCES -DSHADERTOY_OSMESA -DSHADERTOY_BUILD="\"$BUILD_ID\"" -lSDL2 -lSDL2_image -lGLEW -lOSMesa -lGL -pthread
+
+    sleep 1
+
+    ./shadertoy_renderer "$@"
+else
+    g++ -o shadertoy_renderer $SOURCES -DSHADERTOY_BUILD="\"$BUILD_ID\"" -lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lglew32 -lopengl32
+
+    sleep 1
+
+    ./shadertoy_renderer.exe "$@"
+fi
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef BENCH_STORE_H
+#define BENCH_STORE_H
+
+#include "benchmark.h"
+
+
+// One measured series of one scenario as kept in the results store. The file is
+// append-only text, one tab-separated record per line:
+//   run  unix-time  build  driver  shader  source-hash  WxH  fixed|wall  series  ms,ms,...
+struct BenchRecord {
+    std::string run;
+    long long time = 0;
+    std::string build;          // Renderer build (git revision, or compile time)
+    std::string driver;         // GL_RENDERER and GL_VERSION
+    std::string shader;
+    uint64_t sourceHash = 0;    // All source files of the shader plus its defines
+    int width = 0;
+    int height = 0;
+    bool fixedTime = true;
+    std::string series;         // cpu_ms, gpu_ms or frame_ms
+    std::vector<double> samples;
+};
+
+// Identifier of this renderer build
+const char* getBenchBuild();
+
+// Append every series of the report as records of run
+bool appendBenchStore(const std::string& path, const std::string& run, const BenchReport& report);
+
+// Read all records, oldest first
+bool loadBenchStore(const std::string& path, std::vector<BenchRecord>& records);
+
+// Result of a two-sided Mann-Whitney U test of candidate against base
+struct MannWhitneyResult {
+    double u = 0.0;             // U of the candidate sample
+    double pValue = 1.0;        // Normal approximation with tie and continuity correction
+    double slowerShare = 0.5;   // Chance that a candidate sample is above a base sample
+};
+
+MannWhitneyResult mannWhitneyU(const std::vector<double>& base, const std::vector<double>& candidate);
+
+// Compare two runs of the store (names, or "last" / "previous") scenario by scenario.
+// A series regresses when its distribution shifted up significantly (p < 0.01) and the
+// median grew by at least 2%. Returns 1 if anything regressed, 2 on errors, else 0.
+int compareBenchRuns(const std::string& path, const std::string& baseRun, const std::string& candidateRun);
+
+#endif // BENCH_STORE_H
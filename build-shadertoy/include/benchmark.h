@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "includes.h"
+
+
+// One run of a benchmark script. Script lines are key=value pairs, '#' starts a comment:
+//   shader=shader8 size=1920x1080 frames=300 time=fixed warmup=30 mouse=0.2,0.5;0.8,0.5
+// shader is a registry number or name, or "all" for one run of every shader (required);
+// the run lasts frames=N or seconds=S (default 300 frames); time=fixed steps iTime by
+// 1/fps, time=wall follows the clock; mouse is a path of normalized points (0-1,
+// top-left origin) the held-down mouse follows at constant speed over the run.
+struct BenchScenario {
+    std::string shader;
+    int width = 1920;
+    int height = 1080;
+    int frames = 300;
+    double seconds = 0.0;       // Measure for this long instead of a frame count
+    bool fixedTime = true;
+    double fps = 60.0;          // Timestep of fixed time
+    int warmup = 30;            // Frames rendered before measuring (compile, caches, clocks)
+    std::vector<float> mousePath;   // x0, y0, x1, y1, ...
+    int line = 0;               // Script line, for messages
+
+    // Mouse position along the path at progress t (0-1); false without a path
+    bool mouseAt(double t, float& x, float& y) const;
+};
+
+// Read a scenario script. Reports every invalid line and returns false if there was one.
+bool loadBenchScript(const std::string& path, std::vector<BenchScenario>& scenarios);
+
+// Distribution of one measured series in milliseconds (nearest-rank percentiles)
+struct BenchSummary {
+    int count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+BenchSummary summarizeSamples(const std::vector<double>& samples);
+
+// Measurements of one scenario. cpuMs is the time to issue a frame, gpuMs the GPU
+// time of its passes (empty without timestamp queries), frameMs the whole frame
+// including the wait for the GPU to finish.
+struct BenchResult {
+    BenchScenario scenario;
+    std::string shaderName;
+    int shaderId = -1;
+    uint64_t sourceHash = 0;    // Hash of every source file and the defines of the shader
+    bool ok = false;            // False when the shader failed to load or compile
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    std::vector<double> frameMs;
+};
+
+// Everything a benchmark run produced, with the GL implementation it ran on
+struct BenchReport {
+    std::string renderer;
+    std::string version;
+    std::vector<BenchResult> results;
+};
+
+// Write the summaries as CSV (PATH.csv, one row per scenario and series) or JSON
+bool writeBenchReport(const std::string& path, const BenchReport& report);
+
+// Short table on stdout
+void printBenchReport(const BenchReport& report);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,12 @@
+#ifndef BENCHMARK_MODE_H
+#define BENCHMARK_MODE_H
+
+#include "options.h"
+#include "shader_registry.h"
+
+
+// --bench: run every scenario of the script offscreen, print and write the
+// percentiles and append the raw samples to the results store
+int runBenchmark(const Options& options, const ShaderRegistry& registry);
+
+#endif // BENCHMARK_MODE_H
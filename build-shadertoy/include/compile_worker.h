@@ -0,0 +1,66 @@
+#ifndef COMPILE_WORKER_H
+#define COMPILE_WORKER_H
+
+#include "includes.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+// Compiles and links programs on a background thread that owns a second GL context
+// sharing objects with the render context. Each finished program is published with
+// a fence sync; the render thread only picks it up once the fence has signalled, so
+// it never uses a program the driver is still building and never waits for one.
+class CompileWorker {
+public:
+    CompileWorker();
+    ~CompileWorker();
+
+    // Create the shared context and start the thread. Call on the render thread with
+    // the render context current; it is current again when this returns.
+    bool start(SDL_Window* window, SDL_GLContext renderContext);
+    void stop();
+    bool isRunning() const { return thread.joinable(); }
+
+    // Queue a program, returns a job id (never 0). With retrievable set the program
+    // is linked so its binary can be stored in the program cache.
+    unsigned int enqueue(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable);
+
+    // Render thread: true once the job is done and its fence has signalled. program
+    // is the linked program (owned by the caller from now on), or 0 if it failed.
+    bool take(unsigned int job, GLuint& program);
+
+    // Drop a job that is no longer wanted, whatever state it is in
+    void cancel(unsigned int job);
+
+private:
+    struct Job {
+        unsigned int id;
+        std::string vertexSource;
+        std::string fragmentSource;
+        bool retrievable;
+    };
+
+    struct Result {
+        unsigned int id;
+        GLuint program;
+        GLsync fence;
+    };
+
+    SDL_Window* window;
+    SDL_GLContext context;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    std::vector<Result> results;
+    std::vector<unsigned int> cancelled;    // Jobs cancelled while being compiled
+    unsigned int nextId;
+    bool running;
+
+    void run();
+    GLuint build(const Job& job);
+};
+
+#endif // COMPILE_WORKER_H
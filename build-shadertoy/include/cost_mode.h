@@ -0,0 +1,10 @@
+#ifndef COST_MODE_H
+#define COST_MODE_H
+
+#include "shader_registry.h"
+
+
+// --cost: print the estimated cost of every shader (or the selected one) without rendering
+int runCostReport(const ShaderRegistry& registry, int selectedShader);
+
+#endif // COST_MODE_H
@@ -0,0 +1,12 @@
+#ifndef EXPORT_MODE_H
+#define EXPORT_MODE_H
+
+#include "options.h"
+#include "shader_registry.h"
+
+
+// --export: render one shader (the selected one, else the first) offscreen at a fixed
+// timestep and write its frames as Y4M, PNG or raw RGBA
+int runExport(const Options& options, const ShaderRegistry& registry, int selectedShader);
+
+#endif // EXPORT_MODE_H
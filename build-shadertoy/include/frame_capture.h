@@ -0,0 +1,73 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "frame_readback.h"
+#include "frame_encoder.h"
+#include <deque>
+
+
+// Local time as 20240131-235959; names recording sessions and benchmark runs
+std::string timestampNow();
+
+// Screenshots and continuous recording of the window without stalling the render
+// loop. Each captured frame is read back asynchronously (FrameReadback), picked up a
+// few frames later once its fence has signaled, and written by background encoder
+// threads: PNG for screenshots, Y4M for recordings. When the encoders fall behind,
+// recorded frames are dropped and counted rather than blocking the frame.
+class FrameCapture {
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Where screenshots and recordings are written (created on first use)
+    void setDirectory(const std::string& path) { directory = path; }
+
+    // Capture the next rendered frame as a PNG
+    void requestScreenshot() { screenshotRequested = true; }
+
+    // Record every frame until stopped; fps only goes into the Y4M header
+    bool startRecording(double fps);
+    void stopRecording();
+    bool isRecording() const { return recording; }
+
+    // Call after rendering a frame, before the swap: queues the readback of the back
+    // buffer when something was requested and hands finished readbacks to the encoders
+    void capture(int width, int height, int frame);
+
+    // Finish pending readbacks and wait for the encoders (blocks, use at exit)
+    void shutdown();
+
+    // Screenshots, recorded / dropped frames and the time capture() took per frame
+    void printStats() const;
+
+private:
+    enum Kind {
+        Screenshot = 1,
+        Recording = 2
+    };
+
+    std::string directory;
+    std::string sessionName;            // Timestamp shared by the files of this run
+    FrameReadback readback;
+    std::deque<int> kinds;              // Kind flags of the readbacks in flight, oldest first
+    FrameEncoder screenshotEncoder;
+    FrameEncoder recordingEncoder;
+    std::string recordingPath;
+    double recordingFps;
+    std::vector<unsigned char> pixels;
+    bool screenshotRequested;
+    bool recording;
+    int recordingCount;
+    int screenshots;
+    int recordedFrames;
+    int droppedFrames;
+
+    // Cost of capture() on the render thread
+    int captureCalls;
+    double captureTotalMs;
+    double captureMaxMs;
+
+    void deliver(bool wait);
+};
+
+#endif // FRAME_CAPTURE_H
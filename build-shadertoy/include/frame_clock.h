@@ -0,0 +1,65 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include "includes.h"
+
+
+// How the time handed to shaders is kept small enough for a 32-bit float
+enum class TimeWrap {
+    None,       // Unbounded, precision drops as the value grows
+    Wrap,       // iTime runs modulo the period (animation continues)
+    Rebase      // At the period the animation restarts: iTime and iFrame go back to zero
+};
+
+// Central time base for the render loop. Elapsed time is accumulated in double
+// precision from the 64-bit performance counter, so it stays exact for days of
+// uptime; only the value handed to shaders is narrowed, after wrapping or rebasing.
+// Pause, speed scale and single-stepping act on the accumulated time.
+class FrameClock {
+public:
+    FrameClock();
+
+    void configure(TimeWrap mode, double periodSeconds);
+
+    // Advance to the current counter value. Returns the frame delta in seconds
+    // (scaled; zero while paused unless a step is pending).
+    double tick();
+
+    // Accumulated time in seconds since start
+    double getTime() const { return time; }
+    double getDelta() const { return delta; }
+
+    // Time for iTime / millis after wrapping or rebasing
+    double getShaderTime() const;
+
+    // True once after a rebase; the caller restarts frame counters and feedback buffers
+    bool consumeRebase();
+
+    void setPaused(bool paused);
+    bool isPaused() const { return paused; }
+
+    // Speed multiplier, 1 = real time
+    void setScale(double scale);
+    double getScale() const { return scale; }
+
+    // Advance a paused clock by the given amount on the next tick
+    void step(double seconds);
+
+private:
+    TimeWrap wrapMode;
+    double period;
+    double secondsPerTick;
+    Uint64 lastCounter;
+    double time;
+    double delta;
+    double rebaseOrigin;    // Accumulated time at the last rebase
+    bool rebased;
+    bool paused;
+    double scale;
+    double pendingStep;
+};
+
+// ShaderToy iDate: year, month (0-11), day of month, seconds since local midnight
+void getShaderToyDate(float date[4]);
+
+#endif // FRAME_CLOCK_H
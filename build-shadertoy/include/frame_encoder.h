@@ -0,0 +1,84 @@
+#ifndef FRAME_ENCODER_H
+#define FRAME_ENCODER_H
+
+#include "includes.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+
+// Output formats of FrameEncoder
+enum class ExportFormat {
+    Y4M,        // One YUV4MPEG2 file, 4:2:0 full-range BT.601 (what ffmpeg reads as yuvj420p)
+    RawRGBA,    // DIRECTORY/frameNNNNNN.rgba, top row first
+    PNG         // DIRECTORY/frameNNNNNN.png
+};
+
+// Format for a file name / spelling: "y4m", "rgba", "png"; false if unknown
+bool parseExportFormat(const std::string& name, ExportFormat& format);
+
+// Writes frames on a pool of worker threads. Conversion (RGBA to YUV, PNG compression)
+// runs in parallel; Y4M frames are written to the file strictly in submission order.
+// The render thread only copies pixels in and blocks when maxQueued frames are
+// already waiting, which bounds memory if the disk cannot keep up.
+class FrameEncoder {
+public:
+    FrameEncoder();
+    ~FrameEncoder();
+
+    // Open the output (file for Y4M, directory otherwise) and start threadCount workers.
+    // Sequence files are named DIRECTORY/<namePrefix>NNNNNN.<format>.
+    bool start(const std::string& path, ExportFormat format, int width, int height, double fps,
+        int threadCount, int maxQueued, const std::string& namePrefix = "frame");
+
+    bool isRunning() const { return !workers.empty(); }
+
+    // Queue a frame (RGBA, bottom row first, as read back from GL). The vector is
+    // swapped with a recycled buffer, so the caller gets storage back for the next frame.
+    // Without wait a full queue returns false and leaves the pixels with the caller.
+    bool submit(int frameNumber, std::vector<unsigned char>& pixels, bool wait = true);
+
+    // Write everything still queued and stop the workers. False if any write failed.
+    bool finish();
+
+    int getWritten() const;
+
+private:
+    struct Job {
+        int sequence;       // Submission order, the order of frames in a Y4M file
+        int frameNumber;    // Used for sequence file names
+        std::vector<unsigned char> pixels;
+    };
+
+    std::string path;
+    std::string namePrefix;
+    ExportFormat format;
+    int width;
+    int height;
+    int maxQueued;
+    std::ofstream stream;   // Y4M output
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable wake;       // Workers: a job arrived or stopping
+    std::condition_variable room;       // submit(): a queue slot became free
+    std::deque<Job> jobs;
+    std::vector<std::vector<unsigned char>> freeBuffers;
+    int nextSequence;
+    int written;
+    bool running;
+    bool failed;
+
+    // Y4M: converted frames waiting for their predecessors
+    std::mutex writeMutex;
+    std::map<int, std::vector<unsigned char>> converted;
+    int nextToWrite;
+
+    void run();
+    bool encode(Job& job);
+    std::string framePath(int frameNumber, const char* extension) const;
+};
+
+#endif // FRAME_ENCODER_H
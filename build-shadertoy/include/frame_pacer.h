@@ -0,0 +1,72 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "includes.h"
+
+
+// How buffer swaps are synchronised with the display
+enum class SwapMode {
+    VSync,          // Swap on vertical blank
+    AdaptiveVSync,  // Swap on vertical blank, tear instead of waiting when late
+    FreeRunning     // Swap immediately
+};
+
+// Frame interval statistics over the recent window, in milliseconds
+struct FrameStats {
+    int count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double jitter = 0.0;    // Standard deviation of the frame interval
+    double p99 = 0.0;
+};
+
+// Paces the main loop on SDL_GetPerformanceCounter. The swap interval picks vsync,
+// adaptive vsync or free running; on top of that an optional limiter holds a target
+// rate by sleeping until shortly before each deadline and spinning the rest, since
+// SDL_Delay alone overshoots by up to a scheduler tick. Deadlines advance by a
+// fixed period so a frame that ran long shortens the next wait instead of adding
+// a full frame of sleep.
+class FramePacer {
+public:
+    FramePacer();
+
+    // Apply a swap mode, falling back to plain vsync when adaptive is not supported.
+    // Returns false if the driver rejected the swap interval.
+    bool setSwapMode(SwapMode mode);
+    SwapMode getSwapMode() const { return swapMode; }
+
+    // Frames per second for the limiter, 0 disables it
+    void setTargetRate(double framesPerSecond);
+    double getTargetRate() const { return targetRate; }
+
+    // Call once per frame after the swap. Waits for the next deadline (if limited)
+    // and records the interval since the previous call.
+    void wait();
+
+    // Duration of the last frame interval in milliseconds
+    double getLastFrameMs() const { return lastFrameMs; }
+
+    FrameStats getStats() const;
+    void printStats() const;
+
+private:
+    static const int HISTORY_SIZE = 240;
+    static const int SPIN_MARGIN_MS = 2;    // Left to spinning after a sleep
+
+    SwapMode swapMode;
+    double targetRate;
+    double tickMs;              // Milliseconds per performance counter tick
+    Uint64 period;              // Limiter period in counter ticks, 0 = off
+    Uint64 deadline;
+    Uint64 lastFrame;
+    double lastFrameMs;
+
+    std::vector<double> intervals;
+    int next;
+    int count;
+};
+
+const char* getSwapModeName(SwapMode mode);
+
+#endif // FRAME_PACER_H
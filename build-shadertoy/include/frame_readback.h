@@ -0,0 +1,51 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include "includes.h"
+
+
+// Asynchronous framebuffer readback through a ring of pixel pack buffers. begin()
+// queues a glReadPixels into the next PBO and fences it; the copy runs on the GPU
+// while later frames render. take() maps the oldest PBO once its fence has signaled,
+// so pixels arrive a few frames late but the render loop never stalls on them.
+class FrameReadback {
+public:
+    FrameReadback();
+    ~FrameReadback();
+
+    // Allocate ringSize PBOs for width x height RGBA8 frames
+    bool init(int width, int height, int ringSize = 3);
+    void destroy();
+
+    // Queue a readback of a framebuffer (0 = the back buffer of the window). Returns
+    // false when every PBO is still waiting to be taken.
+    bool begin(GLuint framebuffer, int frameTag);
+
+    // Outcome of take(): Lost means the oldest readback was used up (its slot is free
+    // again and frameTag is set) but its pixels could not be mapped
+    enum TakeResult { NotReady, Taken, Lost };
+
+    // Oldest finished readback as RGBA, bottom row first (glReadPixels order). Without
+    // wait only frames whose copy has already completed are returned.
+    TakeResult take(std::vector<unsigned char>& pixels, int& frameTag, bool wait);
+
+    int getPending() const { return pending; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    struct Slot {
+        GLuint buffer;
+        GLsync fence;
+        int tag;
+    };
+
+    std::vector<Slot> ring;
+    int head;       // Next slot to write
+    int tail;       // Oldest slot in flight
+    int pending;
+    int width;
+    int height;
+};
+
+#endif // FRAME_READBACK_H
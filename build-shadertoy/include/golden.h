@@ -0,0 +1,43 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "image_compare.h"
+
+
+// Fixed inputs every golden image is rendered with. Buffer passes run every frame up
+// to goldenFrame so their feedback matches; iTime is goldenFrame / goldenFps and the
+// mouse is held down at a fixed fraction of the size.
+const int GOLDEN_FRAME = 90;
+const double GOLDEN_FPS = 60.0;
+const float GOLDEN_MOUSE_X = 0.25f;
+const float GOLDEN_MOUSE_Y = 0.5f;
+
+// A rendered image passes when it is at least this close to its reference
+const double GOLDEN_MIN_SSIM = 0.98;
+
+// Reference image of a shader at one size: DIR/<name>_<W>x<H>.png
+std::string goldenImagePath(const std::string& directory, const std::string& shaderName, int width, int height);
+
+// RGBA, bottom row first as read back from GL; stored as a regular top-down PNG
+bool saveGoldenImage(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+
+// False when the file is missing or has another size
+bool loadGoldenImage(const std::string& path, int width, int height, std::vector<unsigned char>& pixels);
+
+// Outcome for one shader at one size
+struct GoldenResult {
+    enum Status { Passed, Failed, Missing, Updated, Error };
+
+    std::string shader;
+    int width = 0;
+    int height = 0;
+    Status status = Error;
+    ImageQuality quality;
+    double gpuMs = -1.0;        // GPU time of the compared frame, -1 without timestamp queries
+    double compareMs = 0.0;     // PSNR + SSIM
+};
+
+// One line per result plus totals; false if anything failed, was missing or errored
+bool printGoldenReport(const std::vector<GoldenResult>& results, double minPsnr);
+
+#endif // GOLDEN_H
@@ -0,0 +1,13 @@
+#ifndef GOLDEN_MODE_H
+#define GOLDEN_MODE_H
+
+#include "options.h"
+#include "shader_registry.h"
+
+
+// --golden: render every shader (or the selected one) at each --golden-sizes size with
+// fixed inputs and compare against the stored references, or rewrite them with
+// --golden-update
+int runGolden(const Options& options, const ShaderRegistry& registry, int selectedShader);
+
+#endif // GOLDEN_MODE_H
@@ -0,0 +1,72 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "includes.h"
+
+
+// Rolling GPU time statistics of one tag (shader), in milliseconds
+struct GpuStats {
+    int count = 0;      // Samples in the window
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Measures GPU time of tagged spans with a pair of GL_TIMESTAMP queries each. The
+// query pairs live in a ring and are only read once the driver reports them
+// available, a few frames later, so profiling never stalls the pipeline. When every
+// pair is still in flight the span is skipped instead of waiting. Finished samples
+// go into a per-tag window that the statistics are computed from.
+class GpuProfiler {
+public:
+    GpuProfiler();
+    ~GpuProfiler();
+
+    bool init(int tagCount, int ringSize = 8, int historySize = 300);
+    void destroy();
+
+    // False when the driver has no timestamp counter
+    bool isSupported() const { return !ring.empty(); }
+
+    // Bracket the commands to time. Spans may not nest.
+    void begin(int tag);
+    void end();
+
+    // Oldest finished span, already recorded in the statistics. False if none is ready.
+    bool fetch(int& tag, double& milliseconds);
+
+    // Read back everything that has finished
+    void collect();
+
+    GpuStats getStats(int tag) const;
+    int getDropped() const { return dropped; }
+
+    // Print every tag with samples, most expensive (by mean) first
+    void dump(const std::vector<std::string>& names) const;
+
+private:
+    struct Span {
+        GLuint start;
+        GLuint end;
+        int tag;
+    };
+
+    struct History {
+        std::vector<double> samples;
+        int next = 0;
+        int count = 0;
+    };
+
+    std::vector<Span> ring;
+    std::vector<History> history;
+    int historySize;
+    int head;           // Next span to start
+    int tail;           // Oldest span still waiting for its result
+    int pending;
+    bool active;
+    int dropped;        // Spans skipped because the ring was full
+};
+
+#endif // GPU_PROFILER_H
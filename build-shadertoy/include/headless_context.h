@@ -0,0 +1,56 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include "includes.h"
+
+// The OSMesa backend is only compiled in when building with -DSHADERTOY_OSMESA
+#ifdef SHADERTOY_OSMESA
+// glew.h undefines GLAPI/APIENTRY at its end, osmesa.h expects them from gl.h
+#ifndef GLAPI
+#define GLAPI extern
+#endif
+#ifndef APIENTRY
+#define APIENTRY GLAPIENTRY
+#endif
+#include "../../GL/osmesa.h"
+#endif
+
+
+// Offscreen OpenGL 3.3 core context that renders into a client-side RGBA buffer.
+// Used instead of an SDL window + SDL_GL_CreateContext on machines without a display.
+class HeadlessContext {
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    // True when this build has the OSMesa backend compiled in
+    static bool isSupported();
+
+    // Create the context and an offscreen buffer of the given size and make it current
+    bool create(int width, int height);
+
+    // Reallocate the offscreen buffer (e.g. to render at another resolution)
+    bool resize(int width, int height);
+
+    // Destroy the context and free the buffer
+    void destroy();
+
+    // Write the current buffer contents as a binary PPM (top row first)
+    bool savePPM(const std::string& filePath) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Raw RGBA pixels, bottom row first (glReadPixels order)
+    const std::vector<unsigned char>& getPixels() const { return pixels; }
+
+private:
+#ifdef SHADERTOY_OSMESA
+    OSMesaContext context;
+#endif
+    std::vector<unsigned char> pixels;
+    int width;
+    int height;
+};
+
+#endif // HEADLESS_CONTEXT_H
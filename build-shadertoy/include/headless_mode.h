@@ -0,0 +1,17 @@
+#ifndef HEADLESS_MODE_H
+#define HEADLESS_MODE_H
+
+#include "options.h"
+#include "shader_registry.h"
+#include <functional>
+
+
+// --headless: render every shader (or the selected one) into an OSMesa buffer without
+// a window and report the time per frame; --output writes the last frame as PPM
+int runHeadless(const Options& options, const ShaderRegistry& registry, int selectedShader);
+
+// Run body with a current GL 3.3 context but no visible window: OSMesa with --headless,
+// otherwise a hidden SDL window that only provides the context. Used by the offline modes.
+int runOffscreen(const Options& options, const char* title, const std::function<int()>& body);
+
+#endif // HEADLESS_MODE_H
@@ -0,0 +1,53 @@
+#ifndef HEATMAP_OVERLAY_H
+#define HEATMAP_OVERLAY_H
+
+#include "shader_manager.h"
+
+
+// False-color view of the per-pixel loop iterations that a pipeline's heatmap program
+// writes (MultipassPipeline::renderHeatmap). Counts go to a float target at the render
+// size and are blended over the frame; now and then they are read back to rescale the
+// colors and to total them per screen region.
+class HeatmapOverlay {
+public:
+    // Regions per side of the totals grid
+    static const int REGIONS = 4;
+
+    HeatmapOverlay();
+    ~HeatmapOverlay();
+
+    // Submit the overlay program for compilation (nothing if it is built or on its way)
+    // and check on it with poll() each frame. Needs a current GL context.
+    void init();
+    void destroy();
+
+    // Returns true once the overlay program is ready to draw
+    bool poll();
+    bool isReady() const { return overlay.isReady(); }
+    bool hasFailed() const { return overlay.hasFailed(); }
+
+    // Count target for this frame, (re)allocated at width x height
+    GLuint getFramebuffer(int width, int height);
+
+    // Blend the counts over the default framebuffer, blue (none) to red (the
+    // 99th percentile of the last update() or more)
+    void draw(GLuint quadVAO, int screenWidth, int screenHeight);
+
+    // Read the counts back (waits for the GPU) and rescale the colors
+    bool update();
+
+    // Totals of the last update() per region, top row first
+    void printRegions(const std::string& shaderName) const;
+
+private:
+    GLuint framebuffer;
+    GLuint texture;
+    int width;
+    int height;
+    ShaderManager overlay;
+    UniformHandle scaleUniform;
+    float scale;                // Iterations shown as the hottest color
+    std::vector<float> counts;  // Last read back, bottom row first
+};
+
+#endif // HEATMAP_OVERLAY_H
@@ -0,0 +1,22 @@
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include "includes.h"
+
+
+// Quality of an image against a reference
+struct ImageQuality {
+    double psnr = 0.0;      // dB over the RGB channels, infinity for identical images
+    double ssim = 0.0;      // Mean SSIM of the luma, 8x8 windows every 4 pixels (1 = identical)
+};
+
+// Compare two RGBA8 images of the same size (alpha is ignored). The SSE2 kernels are
+// used where the compiler targets SSE2 (every x86-64 build); simd = false forces the
+// scalar versions, which give the same results.
+ImageQuality compareImages(const unsigned char* image, const unsigned char* reference, int width, int height,
+    bool simd = true);
+
+// Whether compareImages can use SIMD in this build
+bool hasSimdImageCompare();
+
+#endif // IMAGE_COMPARE_H
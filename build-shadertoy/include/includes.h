@@ -1,9 +1,9 @@
 #ifndef INCLUDES_H
 #define INCLUDES_H
 
-#include "..\..\SDL\SDL.h"
-#include "..\..\GL\glew.h"
-#include "..\..\SDL\SDL_opengl.h"
+#include "../../SDL/SDL.h"
+#include "../../GL/glew.h"
+#include "../../SDL/SDL_opengl.h"
 #include <iostream>
 #include <vector>
 #include <string>
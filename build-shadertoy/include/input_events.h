@@ -0,0 +1,43 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+
+#include "includes.h"
+#include "spsc_queue.h"
+
+
+// What the event thread tells the render thread
+struct InputCommand {
+    enum Type { Quit, Key, MouseMove, MouseButton, Resize };
+
+    Type type = Quit;
+    SDL_Keycode key = 0;
+    int x = 0;              // Mouse position, or new window size for Resize
+    int y = 0;
+    bool down = false;      // Left mouse button state
+    Uint32 timestamp = 0;   // SDL event time (ms), for input latency
+};
+
+typedef SpscQueue<InputCommand, 256> InputQueue;
+
+// Translate pending SDL events into commands. With waitMs > 0 blocks up to that long
+// for the first event. Returns false once a quit request has been queued.
+bool pumpEvents(InputQueue& queue, int waitMs);
+
+// Input-to-present latency: from the SDL event timestamp to the swap of the first
+// frame that has seen the event
+class InputLatency {
+public:
+    InputLatency();
+
+    void record(Uint32 eventTimestamp);
+    void print() const;
+
+private:
+    static const int HISTORY_SIZE = 256;
+
+    std::vector<double> samples;
+    int next;
+    int count;
+};
+
+#endif // INPUT_EVENTS_H
@@ -0,0 +1,149 @@
+#ifndef MULTIPASS_H
+#define MULTIPASS_H
+
+#include "shader_manager.h"
+#include "texture_cache.h"
+#include <map>
+#include <memory>
+
+
+// Offscreen pass (ShaderToy "Buffer A-D") rendering into a pair of ping-pong float
+// textures. Readers that run after the pass in a frame see this frame's output,
+// readers that run before it (or the pass itself) see the previous frame.
+struct BufferPass {
+    std::string path;
+    std::string code;
+    ShaderManager shader;
+    ChannelInput channels[4];
+    GLuint framebuffers[2];
+    GLuint textures[2];
+    int current;            // Index of the texture holding the most recent output
+
+    BufferPass() : framebuffers{ 0, 0 }, textures{ 0, 0 }, current(0) {}
+};
+
+
+// Every file a pipeline is built from, read ahead of time (on the watcher thread for
+// hot reload) so that loading it does no file I/O
+struct PipelineSources {
+    std::string imagePath;                          // Normalized
+    std::map<std::string, std::string> files;       // Image and buffer passes by path
+    std::map<std::string, DecodedImage> images;     // iChannel images; empty pixels if unreadable
+};
+
+// Read the image pass, the buffer passes it reaches through #iChannelN and their
+// images. Needs no GL context.
+void readPipelineSources(const std::string& imagePath, PipelineSources& sources);
+
+
+// All passes of one ShaderToy shader: the buffer passes its #iChannelN directives
+// reference (recursively) plus the final image pass. Single-pass shaders are a
+// pipeline without buffers.
+class MultipassPipeline {
+public:
+    MultipassPipeline();
+    ~MultipassPipeline();
+
+    // Parse the image pass and load every buffer pass it depends on. Passes are ordered
+    // by their dependency graph; cycles become feedback through the previous frame.
+    // Image inputs are taken from the shared texture cache. defines ("#define" lines)
+    // are put in front of every pass. A pipeline that fails to load reports hasFailed().
+    bool load(const std::string& imageCode, const std::string& imagePath, TextureCache* textureCache,
+        const std::string& defines = "");
+
+    // Same from files read by readPipelineSources(); its images are uploaded on submit()
+    bool load(const PipelineSources& sources, TextureCache* textureCache, const std::string& defines = "");
+
+    // Compile all passes (see ShaderManager::submit / poll). Image inputs are
+    // loaded here, so lazily compiled shaders also load their textures lazily.
+    void submit(ProgramBinaryCache* cache);
+    bool poll(bool wait = false);
+
+    // Aggregate state over all passes
+    bool isLoaded() const { return !imagePath.empty(); }
+    bool isSubmitted() const { return submitted; }
+    bool isReady() const;
+    bool isCompiling() const;
+    bool hasFailed() const;
+
+    // Render the buffer passes into their FBOs and the image pass into the target
+    // framebuffer. Buffers are (re)allocated lazily whenever the size changes.
+    void render(GLuint quadVAO, int width, int height, GLuint targetFramebuffer = 0);
+
+    // Tiled rendering (see TiledRenderer): a frame is drawn pass by pass, every pass as
+    // a series of rectangles. Passes 0 to getPassCount() - 2 are the buffer passes, drawn
+    // into their full-size textures; the last one is the image pass, drawn with the tile
+    // at the origin of imageFramebuffer. endPass() must follow the last tile of a pass.
+    int getPassCount() const { return static_cast<int>(buffers.size()) + 1; }
+    void prepareTiles(int width, int height);
+    void drawTile(int pass, GLuint quadVAO, int x, int y, int tileWidth, int tileHeight, GLuint imageFramebuffer);
+    void endPass(int pass);
+
+    // Heatmap mode: submit the loop-counting variant of the image pass for compilation
+    // (loops receives the number of instrumented loops) and check on it each frame with
+    // pollHeatmap(), like the passes themselves. False if there is nothing to build yet.
+    bool submitHeatmap(int* loops = nullptr);
+    void pollHeatmap();
+    bool hasHeatmap() const { return heatmapShader.isReady(); }
+    bool canBuildHeatmap() const {
+        return isReady() && !heatmapFailed && !heatmapShader.isReady() && !heatmapShader.isCompiling();
+    }
+
+    // Draw the image pass again with the counting variant into framebuffer (after
+    // render(), so it sees this frame's buffers); red = loop iterations of the pixel
+    void renderHeatmap(GLuint quadVAO, int width, int height, GLuint framebuffer);
+
+    // Drop buffer contents, e.g. when the shader is selected again
+    void resetBuffers();
+
+    // Outcome of handing an edited source file to reload()
+    enum ReloadResult {
+        NotUsed,        // The file is not part of this pipeline
+        Recompiling,    // The affected pass was resubmitted, its old program stays in use
+        NeedsRebuild    // #iChannel directives changed, load a new pipeline and swap() it in
+    };
+
+    // Apply new source for one of the pipeline's files (image or buffer pass)
+    ReloadResult reload(const std::string& path, const std::string& code, ProgramBinaryCache* cache);
+
+    // Normalized paths of every source file the pipeline is built from
+    std::vector<std::string> getSourcePaths() const;
+    const std::string& getImagePath() const { return imagePath; }
+    const std::string& getDefines() const { return defines; }
+
+    // Exchange the complete state with another pipeline
+    void swap(MultipassPipeline& other);
+
+    int getBufferCount() const { return static_cast<int>(buffers.size()); }
+    ShaderManager& getImageShader() { return imageShader; }
+
+private:
+    std::string imagePath;
+    std::string imageCode;
+    ChannelInput imageChannels[4];
+    ShaderManager imageShader;
+    ShaderManager heatmapShader;    // Image pass with iteration counters, built on request
+    bool heatmapFailed;             // Until the image pass changes
+    TextureCache* textureCache;
+    const PipelineSources* preloaded;               // During load(sources) only
+    std::map<std::string, DecodedImage> images;     // Read ahead, until submit() uploads them
+    std::string defines;
+    bool loadFailed;
+
+    // Buffer passes in execution order
+    std::vector<std::unique_ptr<BufferPass>> buffers;
+    int bufferWidth;
+    int bufferHeight;
+    bool submitted;
+
+    std::string fragmentSource(const std::string& code) const;
+    int findBuffer(const std::string& path) const;
+    bool loadBuffer(const std::string& path, int depth);
+    void sortBuffers();
+    void allocateBuffers(int width, int height);
+    void releaseBuffers();
+    void resolveTextures(ChannelInput* channels);
+    void bindChannels(const ChannelInput* channels, ShaderManager& shader);
+};
+
+#endif // MULTIPASS_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "includes.h"
+#include "frame_pacer.h"
+#include "frame_clock.h"
+
+
+// Command line options of the renderer
+struct Options {
+    bool headless = false;      // Render offscreen through OSMesa instead of an SDL window
+    int width = 1440;           // Window / offscreen buffer size
+    int height = 720;
+    int frames = 60;            // Frames rendered per shader in headless mode
+    std::string shaderSource = "../shaders";  // Shader directory or manifest
+    std::string shader;         // Shader number or name to start with / render headless, empty = all
+    std::string outputDir;      // Headless: write the last frame of each shader here as PPM
+    std::string exportPath;     // Export: .y4m file, or directory for a frame sequence
+    std::string exportFormat;   // y4m, rgba or png; by default from the export path (png for a directory)
+    int startFrame = 0;         // Export: first frame written (earlier frames are rendered, not saved)
+    int exportThreads = 0;      // Export: encoder threads, 0 = one per core minus the render thread
+    int tileSize = 0;           // Export: render in tiles starting at this edge, 0 = only beyond the GPU's limits
+    double tileBudgetMs = 100.0;     // Export: GPU time a single tile may take
+    std::string benchScript;    // Benchmark: scenario script to run instead of the renderer
+    std::string benchOutput = "benchmark.json";  // Benchmark: results, CSV for a .csv path, JSON otherwise
+    std::string benchStore = "../bench/results.tsv";  // Benchmark: append-only store of raw samples, "" = none
+    std::string benchRun;       // Benchmark: name of the run in the store, default its start time
+    std::string compareBase;    // --compare: runs of the store to test against each other
+    std::string compareCandidate;
+    std::string goldenDir;      // Golden images: reference directory to compare against
+    bool goldenUpdate = false;  // Golden images: write the references instead of comparing
+    std::string goldenSizes = "320x180,640x360";   // Golden images: sizes every shader is rendered at
+    double goldenMinPsnr = 40.0;     // Golden images: lowest PSNR (dB) that still passes
+    std::string captureDir = "../captures";  // Screenshots (F9) and recordings (F10)
+    bool record = false;        // Start recording with the first frame
+    bool heatmap = false;       // Start with the loop iteration heatmap overlay (F11)
+    bool costReport = false;    // Print the estimated per-pixel cost of the shaders and exit
+    bool lazy = false;          // Compile shaders on first selection instead of at startup
+    bool dynamicResolution = false;  // Render at a variable internal scale driven by GPU time
+    double frameBudgetMs = 16.6;     // GPU time the dynamic resolution governor aims for
+    float minScale = 0.25f;          // Lowest internal render scale
+    SwapMode swapMode = SwapMode::VSync;
+    double targetFps = 0.0;     // Frame limiter rate, 0 = no limiter
+    TimeWrap timeWrap = TimeWrap::None;
+    double timePeriod = 0.0;    // Seconds after which iTime wraps / rebases
+    double timeScale = 1.0;
+    bool renderThread = true;   // Render on its own thread, events stay on the main thread
+    bool compileThread = true;  // Compile on a worker thread with a shared GL context
+    bool watch = true;          // Recompile shader files when they are edited
+    bool useBinaryCache = true; // Load/store linked program binaries on disk
+    std::string cacheDir = "../cache";
+};
+
+// Parse the command line into options. Returns false on invalid input or --help.
+bool parseOptions(int argc, char* argv[], Options& options);
+
+// Print the supported command line options
+void printUsage(const char* programName);
+
+#endif // OPTIONS_H
\ No newline at end of file
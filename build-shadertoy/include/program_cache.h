@@ -0,0 +1,46 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "includes.h"
+#include <cstdint>
+
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+// Entries are keyed by a hash of the driver vendor/renderer/version and both shader
+// sources, so a driver update or any source change simply misses the cache.
+class ProgramBinaryCache {
+public:
+    explicit ProgramBinaryCache(const std::string& directory);
+
+    // Query driver support and create the cache directory. Needs a current GL context.
+    bool init();
+
+    // False when the driver exposes no binary formats or init() was not called
+    bool isEnabled() const { return enabled; }
+
+    // Create a linked program from a cached binary. Returns 0 on a miss or when the
+    // driver rejects the binary (the stale entry is removed so it gets rebuilt).
+    GLuint load(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // Save the binary of a program that was linked with the retrievable hint set
+    void store(GLuint program, const std::string& vertexSource, const std::string& fragmentSource);
+
+    // Statistics for the startup report
+    int getHits() const { return hits; }
+    int getMisses() const { return misses; }
+
+private:
+    std::string directory;
+    std::string driverString;
+    bool enabled;
+    int hits;
+    int misses;
+
+    uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+    std::string entryPath(uint64_t key) const;
+};
+
+// 64-bit FNV-1a hash, also used to checksum cache entries
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+#endif // PROGRAM_CACHE_H
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include "includes.h"
+
+
+// Offscreen RGBA8 color target (FBO + texture) that can be resized and blitted
+// to the window
+class RenderTarget {
+public:
+    RenderTarget();
+    ~RenderTarget();
+
+    // (Re)allocate storage when the size differs from the current one
+    void resize(int width, int height);
+    void destroy();
+
+    // Scale the contents onto the default framebuffer with linear filtering
+    void blitToScreen(int screenWidth, int screenHeight) const;
+
+    GLuint getFramebuffer() const { return framebuffer; }
+    GLuint getTexture() const { return texture; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    GLuint framebuffer;
+    GLuint texture;
+    int width;
+    int height;
+};
+
+#endif // RENDER_TARGET_H
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef RESOLUTION_GOVERNOR_H
+#define RESOLUTION_GOVERNOR_H
+
+#include "includes.h"
+
+
+// Picks the internal render scale from measured GPU frame times. The scale only
+// goes down when the smoothed time is over budget and only goes up when there is
+// clear headroom; between the two thresholds (and for a cooldown after every
+// change) it holds still, so it does not oscillate around the budget.
+class ResolutionGovernor {
+public:
+    ResolutionGovernor();
+
+    // Frame budget in milliseconds and the allowed scale range
+    void configure(double budgetMs, float minScale, float maxScale);
+
+    // Feed one GPU frame time. Returns true when the scale changed.
+    bool update(double gpuMs);
+
+    // Start over from a given scale (e.g. after switching shaders)
+    void reset(float scale);
+
+    // Scale a shader of the given estimated cost (ShaderRegistry::getCost) should
+    // start at to fit the budget, so an expensive one does not first run at full size
+    // for a while. Uses the GPU time per cost measured by calibrate(), or a cautious
+    // default before that. A cost of 0 (unknown) keeps the current scale.
+    float getStartScale(float cost, int outputWidth, int outputHeight) const;
+
+    // Learn the GPU time per cost and pixel from the shader that ran since the last
+    // reset(). Does nothing until enough frames were measured.
+    void calibrate(float cost, int outputWidth, int outputHeight);
+
+    float getScale() const { return scale; }
+    double getSmoothedMs() const { return smoothedMs; }
+
+    // Internal render size for an output size at the current scale
+    void getRenderSize(int outputWidth, int outputHeight, int& renderWidth, int& renderHeight) const;
+
+private:
+    double budgetMs;
+    float minScale;
+    float maxScale;
+    float scale;
+    double smoothedMs;
+    int samples;
+    int cooldown;
+    double msPerCost;       // GPU ms per unit of cost and megapixel, 0 = not measured yet
+};
+
+#endif // RESOLUTION_GOVERNOR_H
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef SHADER_COST_H
+#define SHADER_COST_H
+
+#include "includes.h"
+
+
+// Rough per-pixel work of a ShaderToy shader, estimated from its source without
+// compiling or running it. The code is preprocessed (#define constants, #if / #ifdef),
+// mainImage() is walked with the functions it calls inlined, and every loop multiplies
+// its body by its trip count. Counts are upper bounds: loops run to their limit
+// (early exits are what the heatmap shows) and of two branches the dearer one counts.
+struct ShaderCost {
+    double alu = 0.0;               // Operators and cheap built-ins
+    double transcendental = 0.0;    // sin, exp, pow, sqrt, ... (special function units)
+    double texture = 0.0;           // Texture lookups
+    int loops = 0;                  // Loops reached from mainImage()
+    int guessedLoops = 0;           // Of those, loops whose trip count could not be worked out
+
+    // Single relative figure weighting the three kinds: 1 is about a thousand
+    // ALU operations per pixel. This is what ShaderRegistry::getCost() returns.
+    float getScore() const;
+
+    ShaderCost& operator+=(const ShaderCost& other);
+};
+
+// Estimate of one pass. defineBlock is put in front of the code the way the pipeline
+// does it (ShaderRegistry::getDefineBlock). No mainImage() gives a zero cost.
+ShaderCost estimateShaderCost(const std::string& shaderToyCode, const std::string& defineBlock = "");
+
+// Estimate of a shader file plus every buffer pass it reads through #iChannelN,
+// each file counted once. The files are read on every call; estimates are reused
+// while their sources hash the same. Not thread-safe.
+ShaderCost estimateShaderFileCost(const std::string& imagePath, const std::string& defineBlock = "");
+
+// One line per shader: operations per pixel by kind, loops and the score
+void printShaderCostReport(const std::vector<std::string>& names, const std::vector<ShaderCost>& costs);
+
+#endif // SHADER_COST_H
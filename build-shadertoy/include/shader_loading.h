@@ -0,0 +1,37 @@
+#ifndef SHADER_LOADING_H
+#define SHADER_LOADING_H
+
+#include "options.h"
+#include "shader_registry.h"
+#include "multipass.h"
+
+
+// Registry shaders as pipelines, one slot per registry id, shared by the window and
+// the offline modes
+
+// Load one registry shader together with the buffer passes it references. Does nothing
+// if it is loaded already. A shader that fails to load is reported as failed from then on.
+void loadShader(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, int index,
+    TextureCache* textureCache);
+
+// Load every shader of the registry
+void loadShaders(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, TextureCache* textureCache);
+
+// Milliseconds elapsed since a SDL_GetPerformanceCounter() value
+double millisecondsSince(Uint64 start);
+
+// Submit all passes of one shader for compilation
+void submitShader(std::vector<MultipassPipeline>& pipelines, int index, ProgramBinaryCache* cache);
+
+// Submit every loaded shader for compilation without waiting for any of them, in the
+// given order of ids (id order when empty)
+void submitShaders(std::vector<MultipassPipeline>& pipelines, ProgramBinaryCache* cache,
+    const std::vector<int>& order = std::vector<int>());
+
+// Compile every loaded shader and wait until all are done, using the binary cache when enabled
+bool compileShaders(std::vector<MultipassPipeline>& pipelines, ProgramBinaryCache* cache);
+
+// Open the program binary cache unless it was disabled on the command line
+void initBinaryCache(const Options& options, ProgramBinaryCache& cache);
+
+#endif // SHADER_LOADING_H
@@ -2,15 +2,69 @@
 #define SHADER_MANAGER_H
 
 #include "includes.h"
+#include "program_cache.h"
+#include "uniform_buffer.h"
+#include "compile_worker.h"
 
 
 // Default vertex shader for ShaderToy-style rendering
 extern const char* defaultVertexShader;
 
+// Cheap ShaderToy code shown while the selected shader is compiling
+extern const char* placeholderShaderCode;
+
 // Create a ShaderToy-compatible fragment shader
 std::string createShaderToyFragmentShader(const std::string& shaderToyCode);
 
+// Heatmap mode: the same wrapper, but every for loop of the code counts its iterations
+// (the condition becomes "(cond) && heatCount()") and main() writes the pixel's total
+// to the red channel instead of the color. loopCount receives the number of loops.
+std::string createHeatmapFragmentShader(const std::string& shaderToyCode, int* loopCount = nullptr);
+
+// The loop rewriting of the heatmap mode on its own
+std::string instrumentLoops(const std::string& shaderToyCode, int* loopCount = nullptr);
+
+// Load shader code from a file, returns "" on failure
+std::string loadShaderFromFile(const std::string& filePath);
+
+// Input of one iChannel, declared in the shader source with #iChannelN "file://..."
+struct ChannelInput {
+    enum Type { None, Buffer, Texture };
+    Type type = None;
+    std::string path;   // Buffer pass source (.glsl) or image, relative paths resolved against the shader
+
+    // Texture inputs, filled in from the TextureCache when the shader is submitted
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// ShaderToy code with its #iChannelN directives split out
+struct ShaderToySource {
+    std::string code;               // Directive lines blanked, ready for createShaderToyFragmentShader
+    ChannelInput channels[4];
+};
 
+// Canonical spelling of a path so the same file is always recognised ("a/../b" -> "b")
+std::string normalizeShaderPath(const std::string& path);
+
+// Split "#iChannelN" directives (VS Code Shader Toy syntax) out of ShaderToy code.
+// "self" refers to the file itself, paths ending in .glsl are buffer passes.
+ShaderToySource parseShaderToySource(const std::string& shaderToyCode, const std::string& filePath);
+
+
+
+// Handle of a uniform in a linked program (its location), -1 when the program
+// does not use the uniform. Setters ignore -1 handles.
+typedef GLint UniformHandle;
+
+// Active uniform found by reflection after linking
+struct UniformInfo {
+    std::string name;   // Array uniforms are stored without the "[0]" suffix
+    GLint location;
+    GLenum type;
+    GLint size;
+};
 
 class ShaderManager {
 public:
@@ -18,27 +72,95 @@ public:
     ShaderManager();
     ~ShaderManager();
     
-    // Load shaders from strings
-    bool loadFromStrings(const std::string& vertexSource, const std::string& fragmentSource);
+    // Load shaders from strings and wait for the result. With a cache the linked program
+    // is taken from / stored to disk so a warm start skips GLSL compilation.
+    bool loadFromStrings(const std::string& vertexSource, const std::string& fragmentSource,
+        ProgramBinaryCache* cache = nullptr);
+
+    // Start compiling and linking without querying any status, so the driver can work on
+    // several programs at once. The current program stays usable until the new one links.
+    void submit(const std::string& vertexSource, const std::string& fragmentSource,
+        ProgramBinaryCache* cache = nullptr);
+
+    // Check a submitted program. Returns true once it has finished (linked or failed).
+    // Without wait this only blocks when the driver lacks parallel shader compile.
+    bool poll(bool wait = false);
+
+    // Ask the driver for background compiler threads (KHR/ARB_parallel_shader_compile).
+    // Returns false when poll() has to block on compilation.
+    static bool enableParallelCompile();
+    static bool hasParallelCompile() { return parallelCompile; }
+
+    // Compile on a worker thread with a shared context instead (nullptr to turn off)
+    static void setCompileWorker(CompileWorker* worker) { compileWorker = worker; }
+    static bool hasCompileWorker() { return compileWorker != nullptr; }
+
+    // State of the program
+    bool isReady() const { return programID != 0; }
+    bool isCompiling() const { return pendingProgram != 0 || pendingJob != 0; }
+    bool hasFailed() const { return failed; }
     
     // Use the shader program
     void use();
     
-    // Set uniform values
+    // Look up a uniform in the reflected table, -1 if the program does not use it.
+    // Handles stay valid until the program is replaced by a new submit().
+    UniformHandle getUniform(const std::string& name) const;
+    const std::vector<UniformInfo>& getUniforms() const { return uniforms; }
+
+    // Set uniform values through a handle (program must be in use)
+    void setFloat(UniformHandle handle, float value);
+    void setInt(UniformHandle handle, int value);
+    void setVec2(UniformHandle handle, float x, float y);
+    void setVec3(UniformHandle handle, float x, float y, float z);
+    void setVec4(UniformHandle handle, float x, float y, float z, float w);
+    void setVec3Array(UniformHandle handle, const float* values, int count);
+
+    // Handle of the wrapper's iChannelResolution[4], cached at link time
+    UniformHandle getChannelResolutionUniform() const { return channelResolutionUniform; }
+
+    // Handle of the wrapper's iFragCoordOffset (tiled rendering), cached at link time
+    UniformHandle getFragCoordOffsetUniform() const { return fragCoordOffsetUniform; }
+
+    // Set uniform values by name (table lookup, no driver query)
     void setFloat(const std::string& name, float value);
     void setInt(const std::string& name, int value);
     void setVec2(const std::string& name, float x, float y);
     void setVec3(const std::string& name, float x, float y, float z);
     void setVec4(const std::string& name, float x, float y, float z, float w);
     
-    // ShaderToy specific functions
-    void setupShaderToyUniforms(int windowWidth, int windowHeight, float time, float deltaTime, int frame, int mouseX, int mouseY, bool mouseDown);
-    
     // Get the program ID
     GLuint getProgramID() const { return programID; }
 
+    // Exchange programs and in-flight state with another manager
+    void swap(ShaderManager& other);
+
 private:
     GLuint programID;
+
+    // Reflection of the linked program
+    std::vector<UniformInfo> uniforms;
+    UniformHandle channelResolutionUniform;
+    UniformHandle fragCoordOffsetUniform;
+
+    // In-flight compilation started by submit()
+    GLuint pendingProgram;
+    GLuint pendingVertexShader;
+    GLuint pendingFragmentShader;
+    std::string pendingVertexSource;
+    std::string pendingFragmentSource;
+    ProgramBinaryCache* pendingCache;
+    unsigned int pendingJob;        // Compile worker job, 0 if none
+    bool failed;
+
+    static bool parallelCompile;
+    static CompileWorker* compileWorker;
+
+    void finishPending();
+    bool pollWorker(bool wait);
+    void setProgram(GLuint program);
+    void reflectUniforms();
+    void releasePending();
     bool checkCompileErrors(GLuint shader, const std::string& type);
     bool checkLinkErrors(GLuint program);
 };
@@ -46,4 +168,7 @@ private:
 // Helper function to create a full-screen quad for rendering
 GLuint createFullScreenQuad();
 
+// Clear and draw the quad with the given shader (globals come from the shared uniform buffer)
+void renderShaderToyFrame(ShaderManager& shaderManager, GLuint quadVAO);
+
 #endif // SHADER_MANAGER_H
\ No newline at end of file
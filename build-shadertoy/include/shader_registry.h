@@ -0,0 +1,71 @@
+#ifndef SHADER_REGISTRY_H
+#define SHADER_REGISTRY_H
+
+#include "includes.h"
+#include <cstdint>
+
+
+// The set of shaders the renderer offers, read from a shader directory or a manifest.
+//
+// Manifest (shaders.txt in the directory, or any file passed instead of a directory),
+// one shader per line, paths relative to the manifest:
+//
+//     # name | image pass | quality defines | estimated cost
+//     cubes | shader1.glsl | QUALITY=2 SHADOWS | 1.5
+//
+// Names are letters, digits, '-', '_' and '.' so --shader and bench scripts take them
+// as they are; other names are indexed with a warning.
+//
+// Without a manifest every .glsl file of the directory is a shader, except files that
+// another shader reads as a buffer pass, named after the file and in natural order.
+//
+// A cost the manifest leaves out is estimated from the current sources on request
+// (estimateShaderFileCost, buffer passes included), so edits show up right away.
+//
+// The result is kept in a compact binary index (fixed-size entries, a hash table for
+// name lookup and one string table) that is memory-mapped on the next start. While
+// the directory / manifest modification time is unchanged no shader file is opened
+// at startup, however many there are.
+class ShaderRegistry {
+public:
+    ShaderRegistry();
+    ~ShaderRegistry();
+
+    // Open the shaders of a directory or manifest, reusing the index at indexPath
+    // when it is still valid and rewriting it otherwise
+    bool open(const std::string& source, const std::string& indexPath);
+    void close();
+
+    // Shaders are identified by their 0-based id, shown to the user 1-based
+    int getCount() const { return count; }
+    const char* getName(int id) const;
+    std::string getPath(int id) const;       // Image pass source file
+    const char* getDefines(int id) const;    // Space separated NAME or NAME=VALUE
+    float getCost(int id) const;             // Relative cost per pixel (ShaderCost::getScore), 0 = unknown;
+                                             // reads the shader files unless the manifest gives it
+
+    // Id of a shader given by its 1-based number or its name, -1 if there is none
+    int find(const std::string& nameOrNumber) const;
+
+    // Quality defines as "#define" lines to put in front of the shader code
+    std::string getDefineBlock(int id) const;
+
+    // Names in id order, for reports
+    std::vector<std::string> getNames() const;
+
+private:
+    std::string directory;          // Shader paths in the index are relative to this
+    const char* data;               // Index contents, mapped or in memory
+    size_t size;
+    bool mapped;
+    std::vector<char> memory;       // Fallback when the index cannot be written
+    int count;
+
+    void release();
+    bool mapIndex(const std::string& indexPath, uint64_t sourceHash, int64_t sourceStamp);
+    bool validate(uint64_t sourceHash, int64_t sourceStamp) const;
+    bool buildIndex(const std::string& source, bool isManifest, uint64_t sourceHash, int64_t sourceStamp,
+        std::vector<char>& index) const;
+};
+
+#endif // SHADER_REGISTRY_H
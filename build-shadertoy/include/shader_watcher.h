@@ -0,0 +1,77 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include "includes.h"
+#include "multipass.h"
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+
+// New contents of a watched file, read on the watcher thread
+struct ShaderChange {
+    std::string path;       // Normalized, as passed to start()
+    std::string code;
+};
+
+// Watches shader source files from a background thread and reads edited files (and
+// the sources of pipelines that need a rebuild) there, so the render thread only
+// picks up finished strings. Uses inotify on the files'
+// directories on Linux (editors often save by renaming a temp file, which a watch on
+// the file itself would miss) and polls modification times elsewhere.
+class ShaderWatcher {
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    bool start(const std::vector<std::string>& paths);
+    void stop();
+
+    // Watch more files without restarting; paths already watched are ignored. Safe to
+    // call from any thread, the watcher thread sets up the watches.
+    void addPaths(const std::vector<std::string>& paths);
+
+    // Read everything a pipeline rebuild needs (readPipelineSources) on the watcher
+    // thread; the result comes back from takeSources(). Safe to call from any thread.
+    void requestSources(const std::string& imagePath);
+    std::vector<PipelineSources> takeSources();
+
+    // Changes read since the last call, at most one per file
+    std::vector<ShaderChange> takeChanges();
+
+private:
+    static constexpr int POLL_INTERVAL_MS = 250;
+    static constexpr int SETTLE_MS = 50;    // Let an editor finish writing before reading
+
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::condition_variable wake;           // Polling thread: stop or new paths
+    std::vector<ShaderChange> changes;
+    std::vector<std::string> addedPaths;    // Waiting for the watcher thread
+    std::vector<std::string> sourceRequests;
+    std::vector<PipelineSources> sources;
+
+    // Owned by the watcher thread while it runs
+    std::vector<std::string> paths;
+#ifdef __linux__
+    int inotifyFd;
+    int wakeFd;                             // eventfd that interrupts the inotify wait
+    std::vector<std::pair<int, std::string>> directories;   // Watch descriptor, directory
+    void runInotify();
+    void watchDirectory(const std::string& path);
+#endif
+    std::vector<std::filesystem::file_time_type> modified;
+    void runPolling();
+
+    // Move addedPaths into paths; returns the ones that were new
+    std::vector<std::string> takeAddedPaths();
+    void readRequestedSources();
+    void wakeThread();
+
+    void readChanged(const std::string& path);
+};
+
+#endif // SHADER_WATCHER_H
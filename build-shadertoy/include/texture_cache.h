@@ -0,0 +1,52 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "includes.h"
+#include <cstdint>
+#include <unordered_map>
+
+
+// Image texture owned by the cache
+struct CachedTexture {
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Pixels of an image file: tightly packed RGBA8 rows, bottom row first
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// Decode an image file without touching GL, so it can run on any thread once
+// SDL_image is initialized. False (with a message) if the file cannot be read.
+bool decodeImage(const std::string& path, DecodedImage& image);
+
+// Shared store of iChannel image textures. Every image is decoded, uploaded and
+// mipmapped once; files with identical pixels share one texture, and textures stay
+// resident across shader switches until the cache is destroyed. SDL_image must be
+// initialized by the program (IMG_Init) before the first acquire().
+class TextureCache {
+public:
+    TextureCache();
+    ~TextureCache();
+
+    // Texture for an image file, loading it on first use. Returns an empty
+    // CachedTexture (texture 0) if the image cannot be loaded; failures are not
+    // remembered, so a fixed or added file loads on the next request.
+    // decoded, if given, holds the file's pixels read ahead of time.
+    CachedTexture acquire(const std::string& path, const DecodedImage* decoded = nullptr);
+
+    // Delete all textures. Needs the GL context that created them.
+    void destroy();
+
+    int getTextureCount() const { return static_cast<int>(byContent.size()); }
+
+private:
+    std::unordered_map<std::string, CachedTexture> byPath;
+    std::unordered_multimap<uint64_t, CachedTexture> byContent;
+};
+
+#endif // TEXTURE_CACHE_H
\ No newline at end of file
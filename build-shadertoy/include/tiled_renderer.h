@@ -0,0 +1,52 @@
+#ifndef TILED_RENDERER_H
+#define TILED_RENDERER_H
+
+#include "multipass.h"
+#include "render_target.h"
+#include "gpu_profiler.h"
+
+
+// Renders frames too large for a single draw (poster sizes): every pass is split into
+// tiles, and each tile is drawn and finished as its own GPU submission, so no draw can
+// run into the driver's watchdog timeout. Image pass tiles are read back straight
+// into their place in the full image, which only exists in system memory, so the
+// output may exceed the viewport and texture size limits. Tile sizes follow the
+// measured GPU time: the next tile is sized from the cost per pixel of the last ones
+// to stay under the budget.
+class TiledRenderer {
+public:
+    TiledRenderer();
+    ~TiledRenderer();
+
+    // tileSize: edge of the first tiles of every pass; budgetMs: GPU time one tile may take
+    void init(int tileSize, double budgetMs);
+    void destroy();
+
+    // True when a width x height frame is beyond what this GPU can draw at once
+    static bool isRequired(int width, int height);
+
+    // Render one frame of the pipeline (globals already uploaded). With pixels the image
+    // is stitched into it (RGBA, bottom row first); without, only buffer passes run.
+    bool render(MultipassPipeline& pipeline, GLuint quadVAO, int width, int height, std::vector<unsigned char>* pixels);
+
+    // Tiles drawn, tiles over budget and the GPU time of each pass
+    void printStats() const;
+
+private:
+    GpuProfiler profiler;
+    RenderTarget tileTarget;    // Image pass tile, grows to the largest tile drawn
+    int firstTile;
+    int maxTile;                // Largest edge the GPU accepts for a viewport / texture
+    double budgetMs;
+    std::vector<double> pixelsPerMs;    // Measured throughput of each pass, 0 = not measured yet
+    int tiles;
+    int overBudget;
+    double slowestMs;
+
+    int tileEdge(int pass) const;
+    int tileWidth(int pass, int rowHeight) const;
+    double drawTile(MultipassPipeline& pipeline, int pass, GLuint quadVAO, int x, int y, int w, int h, int width,
+        std::vector<unsigned char>* pixels);
+};
+
+#endif // TILED_RENDERER_H
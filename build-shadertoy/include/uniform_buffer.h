@@ -0,0 +1,54 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include "includes.h"
+
+// Name and binding point of the uniform block every wrapped ShaderToy shader declares
+#define SHADERTOY_GLOBALS_BLOCK "ShaderToyGlobals"
+const GLuint SHADERTOY_GLOBALS_BINDING = 0;
+
+// CPU mirror of the std140 ShaderToyGlobals block emitted by createShaderToyFragmentShader
+struct ShaderToyGlobals {
+    float iResolution[3];   // offset 0
+    float iTime;            // offset 12
+    float iTimeDelta;       // offset 16
+    int iFrame;             // offset 20
+    float padding0[2];      // vec4 members are 16-byte aligned in std140
+    float iMouse[4];        // offset 32
+    float iDate[4];         // offset 48
+};
+
+// Fill the globals for one frame (mouse Y is flipped to ShaderToy's bottom-left origin).
+// Times are narrowed to float here, after the clock has wrapped them.
+ShaderToyGlobals makeShaderToyGlobals(int width, int height, double time, double deltaTime, int frame,
+    int mouseX, int mouseY, bool mouseDown, const float date[4]);
+
+
+// One uniform buffer shared by all programs, written once per frame. Frames rotate
+// through a ring of slots so the CPU never writes data the GPU may still be reading:
+// persistently mapped with fences when GL_ARB_buffer_storage exists, otherwise the
+// buffer is orphaned whenever the ring wraps.
+class ShaderToyGlobalsBuffer {
+public:
+    ShaderToyGlobalsBuffer();
+    ~ShaderToyGlobalsBuffer();
+
+    // Create the buffer. Needs a current GL context.
+    bool init();
+    void destroy();
+
+    // Upload this frame's values and bind them to SHADERTOY_GLOBALS_BINDING
+    void update(const ShaderToyGlobals& globals);
+
+private:
+    static const int RING_SIZE = 3;
+
+    GLuint buffer;
+    GLsizeiptr slotSize;
+    int slot;
+    bool persistent;
+    unsigned char* mapped;
+    GLsync fences[RING_SIZE];
+};
+
+#endif // UNIFORM_BUFFER_H
\ No newline at end of file
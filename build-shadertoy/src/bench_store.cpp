@@ -0,0 +1,300 @@
+#include "../include/bench_store.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+// Build identifier, normally the git revision passed in by build.sh
+#ifndef SHADERTOY_BUILD
+#define SHADERTOY_BUILD __DATE__ " " __TIME__
+#endif
+
+// Significance level and smallest median change worth reporting
+static const double ALPHA = 0.01;
+static const double MIN_CHANGE = 0.02;
+
+const char* getBenchBuild() {
+    return SHADERTOY_BUILD;
+}
+
+// Fields are tab-separated, so tabs and line breaks inside them become spaces
+static std::string storeField(const std::string& text) {
+    std::string field = text;
+    std::replace_if(field.begin(), field.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return field;
+}
+
+bool appendBenchStore(const std::string& path, const std::string& run, const BenchReport& report) {
+    bool exists = std::ifstream(path).good();
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        std::cerr << "Could not open benchmark store " << path << std::endl;
+        return false;
+    }
+    if (!exists) {
+        file << "# run\ttime\tbuild\tdriver\tshader\tsource\tsize\ttime mode\tseries\tsamples (ms)\n";
+    }
+
+    std::string driver = storeField(report.renderer + " / " + report.version);
+    long long now = static_cast<long long>(std::time(nullptr));
+    file << std::setprecision(6);
+    for (const BenchResult& result : report.results) {
+        if (!result.ok) {
+            continue;
+        }
+        const std::pair<const char*, const std::vector<double>*> series[] = {
+            { "cpu_ms", &result.cpuMs }, { "gpu_ms", &result.gpuMs }, { "frame_ms", &result.frameMs }
+        };
+        for (const auto& entry : series) {
+            if (entry.second->empty()) {
+                continue;
+            }
+            file << storeField(run) << "\t" << now << "\t" << storeField(getBenchBuild()) << "\t" << driver << "\t"
+                << storeField(result.shaderName) << "\t" << std::hex << std::setw(16) << std::setfill('0')
+                << result.sourceHash << std::dec << std::setfill(' ') << "\t" << result.scenario.width << "x"
+                << result.scenario.height << "\t" << (result.scenario.fixedTime ? "fixed" : "wall") << "\t"
+                << entry.first << "\t";
+            for (size_t i = 0; i < entry.second->size(); i++) {
+                file << (i > 0 ? "," : "") << (*entry.second)[i];
+            }
+            file << "\n";
+        }
+    }
+
+    file.close();
+    if (!file) {
+        std::cerr << "Could not write benchmark store " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadBenchStore(const std::string& path, std::vector<BenchRecord>& records) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open benchmark store " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t')) {
+            fields.push_back(field);
+        }
+
+        // A damaged line (e.g. an interrupted append) is skipped, the rest stays usable
+        BenchRecord record;
+        size_t x = fields.size() == 10 ? fields[6].find('x') : std::string::npos;
+        bool ok = x != std::string::npos;
+        if (ok) {
+            try {
+                record.run = fields[0];
+                record.time = std::stoll(fields[1]);
+                record.build = fields[2];
+                record.driver = fields[3];
+                record.shader = fields[4];
+                record.sourceHash = std::stoull(fields[5], nullptr, 16);
+                record.width = std::stoi(fields[6].substr(0, x));
+                record.height = std::stoi(fields[6].substr(x + 1));
+                record.fixedTime = fields[7] == "fixed";
+                record.series = fields[8];
+                std::stringstream samples(fields[9]);
+                std::string sample;
+                while (std::getline(samples, sample, ',')) {
+                    record.samples.push_back(std::stod(sample));
+                }
+            }
+            catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            std::cerr << path << ":" << lineNumber << ": damaged record skipped" << std::endl;
+            continue;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+MannWhitneyResult mannWhitneyU(const std::vector<double>& base, const std::vector<double>& candidate) {
+    MannWhitneyResult result;
+    size_t n1 = candidate.size();
+    size_t n2 = base.size();
+    if (n1 == 0 || n2 == 0) {
+        return result;
+    }
+
+    // Rank the pooled samples, ties get the average of their ranks
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(n1 + n2);
+    for (double value : candidate) {
+        pooled.push_back({ value, true });
+    }
+    for (double value : base) {
+        pooled.push_back({ value, false });
+    }
+    std::sort(pooled.begin(), pooled.end(),
+        [](const std::pair<double, bool>& a, const std::pair<double, bool>& b) { return a.first < b.first; });
+
+    double n = static_cast<double>(n1 + n2);
+    double candidateRanks = 0.0;
+    double tieTerm = 0.0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+            j++;
+        }
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++) {
+            if (pooled[k].second) {
+                candidateRanks += rank;
+            }
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    double product = static_cast<double>(n1) * n2;
+    result.u = candidateRanks - n1 * (n1 + 1) / 2.0;
+    result.slowerShare = result.u / product;
+
+    double mean = product / 2.0;
+    double variance = product / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+    if (variance <= 0.0) {
+        // Every sample identical
+        return result;
+    }
+    double deviation = std::max(std::fabs(result.u - mean) - 0.5, 0.0);
+    double z = deviation / std::sqrt(variance);
+    result.pValue = std::erfc(z / std::sqrt(2.0));
+    return result;
+}
+
+// Samples of one run grouped by scenario and series
+struct RunSeries {
+    std::vector<double> samples;
+    uint64_t sourceHash = 0;
+};
+
+struct RunInfo {
+    std::string build;
+    std::string driver;
+    std::map<std::string, RunSeries> series;
+};
+
+static std::string seriesKey(const BenchRecord& record) {
+    return record.shader + "\t" + std::to_string(record.width) + "x" + std::to_string(record.height) + "\t" +
+        (record.fixedTime ? "fixed" : "wall") + "\t" + record.series;
+}
+
+int compareBenchRuns(const std::string& path, const std::string& baseRun, const std::string& candidateRun) {
+    std::vector<BenchRecord> records;
+    if (!loadBenchStore(path, records)) {
+        return 2;
+    }
+
+    // Runs in the order they were appended
+    std::vector<std::string> runs;
+    for (const BenchRecord& record : records) {
+        if (std::find(runs.begin(), runs.end(), record.run) == runs.end()) {
+            runs.push_back(record.run);
+        }
+    }
+    auto resolve = [&runs](const std::string& name) -> std::string {
+        if (name == "last") {
+            return runs.size() >= 1 ? runs[runs.size() - 1] : "";
+        }
+        if (name == "previous") {
+            return runs.size() >= 2 ? runs[runs.size() - 2] : "";
+        }
+        return std::find(runs.begin(), runs.end(), name) != runs.end() ? name : "";
+    };
+    std::string base = resolve(baseRun);
+    std::string candidate = resolve(candidateRun);
+    if (base.empty() || candidate.empty()) {
+        std::cerr << "Run " << (base.empty() ? baseRun : candidateRun) << " is not in " << path << std::endl;
+        return 2;
+    }
+
+    std::map<std::string, RunInfo> info;
+    for (const BenchRecord& record : records) {
+        if (record.run != base && record.run != candidate) {
+            continue;
+        }
+        RunInfo& run = info[record.run];
+        run.build = record.build;
+        run.driver = record.driver;
+        RunSeries& series = run.series[seriesKey(record)];
+        series.samples.insert(series.samples.end(), record.samples.begin(), record.samples.end());
+        series.sourceHash = record.sourceHash;
+    }
+    const RunInfo& before = info[base];
+    const RunInfo& after = info[candidate];
+
+    std::cout << "Base:      " << base << " (build " << before.build << ", " << before.driver << ")" << std::endl;
+    std::cout << "Candidate: " << candidate << " (build " << after.build << ", " << after.driver << ")" << std::endl;
+    if (before.driver != after.driver) {
+        std::cout << "Note: the runs used different drivers" << std::endl;
+    }
+
+    int regressions = 0;
+    int improvements = 0;
+    std::cout << std::fixed;
+    for (const auto& entry : after.series) {
+        std::string label = entry.first;
+        std::replace(label.begin(), label.end(), '\t', ' ');
+        auto match = before.series.find(entry.first);
+        if (match == before.series.end()) {
+            std::cout << "  " << std::left << std::setw(44) << label << std::right << " only in the candidate" << std::endl;
+            continue;
+        }
+
+        const std::vector<double>& baseSamples = match->second.samples;
+        const std::vector<double>& candidateSamples = entry.second.samples;
+        double baseMedian = summarizeSamples(baseSamples).p50;
+        double candidateMedian = summarizeSamples(candidateSamples).p50;
+        double change = baseMedian > 0.0 ? candidateMedian / baseMedian - 1.0 : 0.0;
+        MannWhitneyResult test = mannWhitneyU(baseSamples, candidateSamples);
+
+        const char* verdict = "same";
+        if (test.pValue < ALPHA && change >= MIN_CHANGE && test.slowerShare > 0.5) {
+            verdict = "REGRESSION";
+            regressions++;
+        }
+        else if (test.pValue < ALPHA && change <= -MIN_CHANGE && test.slowerShare < 0.5) {
+            verdict = "faster";
+            improvements++;
+        }
+
+        std::cout << "  " << std::left << std::setw(44) << label << std::right << std::setprecision(3)
+            << std::setw(9) << baseMedian << " -> " << std::setw(9) << candidateMedian << " ms "
+            << std::showpos << std::setprecision(1) << std::setw(7) << change * 100.0 << "%" << std::noshowpos
+            << "  p=" << std::setprecision(4) << test.pValue << "  " << verdict
+            << (match->second.sourceHash != entry.second.sourceHash ? "  (source changed)" : "") << std::endl;
+    }
+    for (const auto& entry : before.series) {
+        if (after.series.find(entry.first) == after.series.end()) {
+            std::string label = entry.first;
+            std::replace(label.begin(), label.end(), '\t', ' ');
+            std::cout << "  " << std::left << std::setw(44) << label << std::right << " only in the base" << std::endl;
+        }
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+    std::cout << regressions << " regressions, " << improvements << " improvements" << std::endl;
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+#include "../include/benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+static bool parseBenchInt(const std::string& text, int& value) {
+    try {
+        size_t used = 0;
+        value = std::stoi(text, &used);
+        return used == text.size();
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+static bool parseBenchDouble(const std::string& text, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used == text.size();
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+// "x,y;x,y;..." into a flat list
+static bool parseMousePath(const std::string& text, std::vector<float>& path) {
+    std::stringstream points(text);
+    std::string point;
+    while (std::getline(points, point, ';')) {
+        size_t comma = point.find(',');
+        double x = 0.0;
+        double y = 0.0;
+        if (comma == std::string::npos || !parseBenchDouble(point.substr(0, comma), x) ||
+            !parseBenchDouble(point.substr(comma + 1), y)) {
+            return false;
+        }
+        path.push_back(static_cast<float>(x));
+        path.push_back(static_cast<float>(y));
+    }
+    return !path.empty();
+}
+
+// Apply one key=value pair; false (with a message) if it is not understood
+static bool parseScenarioField(const std::string& key, const std::string& value, BenchScenario& scenario) {
+    if (key == "shader") {
+        scenario.shader = value;
+        return true;
+    }
+    if (key == "size") {
+        size_t x = value.find('x');
+        return x != std::string::npos && parseBenchInt(value.substr(0, x), scenario.width) &&
+            parseBenchInt(value.substr(x + 1), scenario.height) && scenario.width > 0 && scenario.height > 0;
+    }
+    if (key == "frames") {
+        scenario.seconds = 0.0;
+        return parseBenchInt(value, scenario.frames) && scenario.frames > 0;
+    }
+    if (key == "seconds") {
+        return parseBenchDouble(value, scenario.seconds) && scenario.seconds > 0.0;
+    }
+    if (key == "time") {
+        scenario.fixedTime = (value == "fixed");
+        return value == "fixed" || value == "wall";
+    }
+    if (key == "fps") {
+        return parseBenchDouble(value, scenario.fps) && scenario.fps > 0.0;
+    }
+    if (key == "warmup") {
+        return parseBenchInt(value, scenario.warmup) && scenario.warmup >= 0;
+    }
+    if (key == "mouse") {
+        scenario.mousePath.clear();
+        return parseMousePath(value, scenario.mousePath);
+    }
+    return false;
+}
+
+bool loadBenchScript(const std::string& path, std::vector<BenchScenario>& scenarios) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open benchmark script " << path << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        BenchScenario scenario;
+        scenario.line = lineNumber;
+        std::stringstream fields(line);
+        std::string field;
+        bool empty = true;
+        while (fields >> field) {
+            empty = false;
+            size_t equals = field.find('=');
+            if (equals == std::string::npos ||
+                !parseScenarioField(field.substr(0, equals), field.substr(equals + 1), scenario)) {
+                std::cerr << path << ":" << lineNumber << ": invalid field " << field << std::endl;
+                ok = false;
+            }
+        }
+        if (empty) {
+            continue;
+        }
+        if (scenario.shader.empty()) {
+            std::cerr << path << ":" << lineNumber << ": missing shader=" << std::endl;
+            ok = false;
+            continue;
+        }
+        scenarios.push_back(scenario);
+    }
+
+    if (ok && scenarios.empty()) {
+        std::cerr << "Benchmark script " << path << " has no scenarios" << std::endl;
+        return false;
+    }
+    return ok;
+}
+
+bool BenchScenario::mouseAt(double t, float& x, float& y) const {
+    int points = static_cast<int>(mousePath.size() / 2);
+    if (points == 0) {
+        return false;
+    }
+    if (points == 1) {
+        x = mousePath[0];
+        y = mousePath[1];
+        return true;
+    }
+
+    // Segments are equally long in time
+    double position = std::clamp(t, 0.0, 1.0) * (points - 1);
+    int segment = std::min(static_cast<int>(position), points - 2);
+    float blend = static_cast<float>(position - segment);
+    x = mousePath[segment * 2] + (mousePath[segment * 2 + 2] - mousePath[segment * 2]) * blend;
+    y = mousePath[segment * 2 + 1] + (mousePath[segment * 2 + 3] - mousePath[segment * 2 + 1]) * blend;
+    return true;
+}
+
+BenchSummary summarizeSamples(const std::vector<double>& samples) {
+    BenchSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    };
+
+    double total = 0.0;
+    for (double sample : sorted) {
+        total += sample;
+    }
+    summary.count = static_cast<int>(sorted.size());
+    summary.mean = total / sorted.size();
+    summary.min = sorted.front();
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = sorted.back();
+    return summary;
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+static std::string csvField(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        return text;
+    }
+    std::string quoted = "\"";
+    for (char c : text) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+static void writeJsonSummary(std::ostream& out, const BenchSummary& summary) {
+    out << "{ \"count\": " << summary.count << ", \"mean\": " << summary.mean << ", \"min\": " << summary.min
+        << ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90 << ", \"p95\": " << summary.p95
+        << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }";
+}
+
+static void writeJson(std::ostream& out, const BenchReport& report) {
+    out << "{\n  \"renderer\": " << jsonString(report.renderer) << ",\n  \"version\": " << jsonString(report.version)
+        << ",\n  \"scenarios\": [";
+    for (size_t i = 0; i < report.results.size(); i++) {
+        const BenchResult& result = report.results[i];
+        const BenchScenario& scenario = result.scenario;
+        out << (i > 0 ? "," : "") << "\n    {\n"
+            << "      \"shader\": " << jsonString(result.shaderName) << ",\n"
+            << "      \"id\": " << (result.shaderId + 1) << ",\n"
+            << "      \"ok\": " << (result.ok ? "true" : "false") << ",\n"
+            << "      \"width\": " << scenario.width << ",\n"
+            << "      \"height\": " << scenario.height << ",\n"
+            << "      \"time\": \"" << (scenario.fixedTime ? "fixed" : "wall") << "\",\n"
+            << "      \"warmup\": " << scenario.warmup << ",\n"
+            << "      \"mouse\": " << (scenario.mousePath.empty() ? "false" : "true") << ",\n"
+            << "      \"cpu_ms\": ";
+        writeJsonSummary(out, summarizeSamples(result.cpuMs));
+        out << ",\n      \"gpu_ms\": ";
+        writeJsonSummary(out, summarizeSamples(result.gpuMs));
+        out << ",\n      \"frame_ms\": ";
+        writeJsonSummary(out, summarizeSamples(result.frameMs));
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static void writeCsv(std::ostream& out, const BenchReport& report) {
+    out << "shader,id,ok,width,height,time,warmup,series,count,mean,min,p50,p90,p95,p99,max,renderer\n";
+    for (const BenchResult& result : report.results) {
+        const BenchScenario& scenario = result.scenario;
+        const std::pair<const char*, const std::vector<double>*> series[] = {
+            { "cpu_ms", &result.cpuMs }, { "gpu_ms", &result.gpuMs }, { "frame_ms", &result.frameMs }
+        };
+        for (const auto& entry : series) {
+            BenchSummary summary = summarizeSamples(*entry.second);
+            out << csvField(result.shaderName) << "," << (result.shaderId + 1) << "," << (result.ok ? 1 : 0) << ","
+                << scenario.width << "," << scenario.height << "," << (scenario.fixedTime ? "fixed" : "wall") << ","
+                << scenario.warmup << "," << entry.first << "," << summary.count << "," << summary.mean << ","
+                << summary.min << "," << summary.p50 << "," << summary.p90 << "," << summary.p95 << ","
+                << summary.p99 << "," << summary.max << "," << csvField(report.renderer) << "\n";
+        }
+    }
+}
+
+bool writeBenchReport(const std::string& path, const BenchReport& report) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not open " << path << " for writing!" << std::endl;
+        return false;
+    }
+    file << std::setprecision(6);
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        writeCsv(file, report);
+    }
+    else {
+        writeJson(file, report);
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void printBenchReport(const BenchReport& report) {
+    std::cout << "Benchmark on " << report.renderer << " (" << report.version << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const BenchResult& result : report.results) {
+        const BenchScenario& scenario = result.scenario;
+        std::cout << "  " << std::left << std::setw(20) << result.shaderName << std::right << " " << scenario.width
+            << "x" << scenario.height;
+        if (!result.ok) {
+            std::cout << "  failed" << std::endl;
+            continue;
+        }
+        BenchSummary frame = summarizeSamples(result.frameMs);
+        BenchSummary gpu = summarizeSamples(result.gpuMs);
+        std::cout << "  frame p50 " << frame.p50 << " p95 " << frame.p95 << " p99 " << frame.p99 << " ms";
+        if (gpu.count > 0) {
+            std::cout << ", GPU p50 " << gpu.p50 << " p95 " << gpu.p95 << " ms";
+        }
+        std::cout << " (" << frame.count << " frames)" << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
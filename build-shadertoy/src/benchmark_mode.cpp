@@ -0,0 +1,183 @@
+#include "../include/benchmark_mode.h"
+#include "../include/headless_mode.h"
+#include "../include/shader_loading.h"
+#include "../include/benchmark.h"
+#include "../include/bench_store.h"
+#include "../include/frame_capture.h"
+#include "../include/gpu_profiler.h"
+#include "../include/uniform_buffer.h"
+#include "../include/frame_clock.h"
+#include "../include/render_target.h"
+#include <algorithm>
+
+// Run one benchmark scenario on a freshly loaded pipeline: warm-up frames first, then
+// the measured ones. Every frame is finished before the next starts, so frame times
+// are the full cost of a frame and do not depend on how deep the driver queues.
+static void benchmarkScenario(const ShaderRegistry& registry, ProgramBinaryCache& cache, GLuint quadVAO,
+    ShaderToyGlobalsBuffer& globalsBuffer, BenchResult& result) {
+    const BenchScenario& scenario = result.scenario;
+    int width = scenario.width;
+    int height = scenario.height;
+
+    TextureCache textureCache;
+    std::vector<MultipassPipeline> pipelines(registry.getCount());
+    loadShader(pipelines, registry, result.shaderId, &textureCache);
+
+    // Tells the results store which version of the shader was measured
+    const std::string& defines = pipelines[result.shaderId].getDefines();
+    result.sourceHash = hashBytes(defines.data(), defines.size());
+    for (const std::string& path : pipelines[result.shaderId].getSourcePaths()) {
+        std::string code = loadShaderFromFile(path);
+        result.sourceHash = hashBytes(code.data(), code.size(), result.sourceHash);
+    }
+
+    result.ok = compileShaders(pipelines, &cache);
+    if (!result.ok) {
+        textureCache.destroy();
+        return;
+    }
+    MultipassPipeline& pipeline = pipelines[result.shaderId];
+
+    RenderTarget target;
+    target.resize(width, height);
+    GpuProfiler profiler;
+    profiler.init(1, 8, 1);
+
+    float today[4];
+    getShaderToyDate(today);
+    double frameStep = 1.0 / scenario.fps;
+    double previousTime = 0.0;
+    Uint64 runStart = SDL_GetPerformanceCounter();
+    Uint64 measureStart = 0;
+
+    for (int frame = 0;; frame++) {
+        int measured = frame - scenario.warmup;
+        if (measured == 0) {
+            measureStart = SDL_GetPerformanceCounter();
+        }
+
+        // Progress through the measured part drives the mouse path
+        double progress = 0.0;
+        if (scenario.seconds > 0.0) {
+            double elapsed = measured >= 0 ? millisecondsSince(measureStart) / 1000.0 : 0.0;
+            if (elapsed >= scenario.seconds) {
+                break;
+            }
+            progress = elapsed / scenario.seconds;
+        }
+        else {
+            if (measured >= scenario.frames) {
+                break;
+            }
+            progress = scenario.frames > 1 ? std::max(measured, 0) / static_cast<double>(scenario.frames - 1) : 0.0;
+        }
+
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        double time = scenario.fixedTime ? frame * frameStep : millisecondsSince(runStart) / 1000.0;
+        double deltaTime = scenario.fixedTime ? frameStep : time - previousTime;
+        previousTime = time;
+
+        float mouseX = 0.0f;
+        float mouseY = 0.0f;
+        bool mouseDown = scenario.mouseAt(progress, mouseX, mouseY);
+        float date[4] = { today[0], today[1], today[2], static_cast<float>(time) };
+        globalsBuffer.update(makeShaderToyGlobals(width, height, time, deltaTime, frame,
+            static_cast<int>(mouseX * width), static_cast<int>(mouseY * height), mouseDown, date));
+
+        if (measured >= 0) {
+            profiler.begin(0);
+        }
+        pipeline.render(quadVAO, width, height, target.getFramebuffer());
+        if (measured >= 0) {
+            profiler.end();
+        }
+        double cpuMs = millisecondsSince(frameStart);
+        glFinish();
+        double frameMs = millisecondsSince(frameStart);
+
+        int tag = 0;
+        double gpuMs = 0.0;
+        while (profiler.fetch(tag, gpuMs)) {
+            result.gpuMs.push_back(gpuMs);
+        }
+        if (measured >= 0) {
+            result.cpuMs.push_back(cpuMs);
+            result.frameMs.push_back(frameMs);
+        }
+    }
+
+    profiler.destroy();
+    target.destroy();
+    textureCache.destroy();
+}
+
+int runBenchmark(const Options& options, const ShaderRegistry& registry) {
+    std::vector<BenchScenario> scenarios;
+    if (!loadBenchScript(options.benchScript, scenarios)) {
+        return 1;
+    }
+
+    // Resolve every shader first, so a typo fails before anything renders
+    BenchReport report;
+    for (const BenchScenario& scenario : scenarios) {
+        std::vector<int> ids;
+        if (scenario.shader == "all") {
+            for (int id = 0; id < registry.getCount(); id++) {
+                ids.push_back(id);
+            }
+        }
+        else {
+            ids.push_back(registry.find(scenario.shader));
+        }
+        for (int id : ids) {
+            if (id < 0) {
+                std::cerr << options.benchScript << ":" << scenario.line << ": unknown shader " << scenario.shader << std::endl;
+                return 1;
+            }
+            BenchResult result;
+            result.scenario = scenario;
+            result.shaderId = id;
+            result.shaderName = registry.getName(id);
+            report.results.push_back(result);
+        }
+    }
+
+    return runOffscreen(options, "ShaderToy Benchmark", [&]() {
+        report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        report.version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+        ProgramBinaryCache cache(options.cacheDir);
+        initBinaryCache(options, cache);
+        GLuint quadVAO = createFullScreenQuad();
+        ShaderToyGlobalsBuffer globalsBuffer;
+        globalsBuffer.init();
+
+        bool ok = true;
+        for (size_t i = 0; i < report.results.size(); i++) {
+            BenchResult& result = report.results[i];
+            std::cout << "Scenario " << (i + 1) << "/" << report.results.size() << ": " << result.shaderName << " at "
+                << result.scenario.width << "x" << result.scenario.height << std::endl;
+            benchmarkScenario(registry, cache, quadVAO, globalsBuffer, result);
+            ok = ok && result.ok;
+        }
+
+        globalsBuffer.destroy();
+        glDeleteVertexArrays(1, &quadVAO);
+
+        printBenchReport(report);
+        if (!writeBenchReport(options.benchOutput, report)) {
+            return 1;
+        }
+        std::cout << "Results written to " << options.benchOutput << std::endl;
+
+        // Raw samples go to the store, so later runs can be tested against this one
+        if (!options.benchStore.empty()) {
+            // Default name of a run in the store: its local start time
+            std::string run = options.benchRun.empty() ? timestampNow() : options.benchRun;
+            if (appendBenchStore(options.benchStore, run, report)) {
+                std::cout << "Appended as run " << run << " to " << options.benchStore << std::endl;
+            }
+        }
+        return ok ? 0 : 1;
+    });
+}
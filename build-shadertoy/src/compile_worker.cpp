@@ -0,0 +1,198 @@
+#include "../include/compile_worker.h"
+#include <algorithm>
+
+// Print the info log of a failed shader or program (runs on the worker thread)
+static bool checkStatus(GLuint object, bool isProgram, const char* type) {
+    GLint success = GL_FALSE;
+    GLchar infoLog[1024];
+    if (isProgram) {
+        glGetProgramiv(object, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(object, sizeof(infoLog), NULL, infoLog);
+        }
+    }
+    else {
+        glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(object, sizeof(infoLog), NULL, infoLog);
+        }
+    }
+    if (!success) {
+        std::cerr << "ERROR::" << type << " (compile worker)\n" << infoLog << std::endl;
+    }
+    return success == GL_TRUE;
+}
+
+CompileWorker::CompileWorker() : window(nullptr), context(nullptr), nextId(1), running(false) {
+}
+
+CompileWorker::~CompileWorker() {
+    stop();
+}
+
+bool CompileWorker::start(SDL_Window* targetWindow, SDL_GLContext renderContext) {
+    stop();
+
+    // Creating a context also makes it current, so switch back right away
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    context = SDL_GL_CreateContext(targetWindow);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    SDL_GL_MakeCurrent(targetWindow, renderContext);
+    if (!context) {
+        std::cerr << "Shared compile context could not be created: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    window = targetWindow;
+    running = true;
+    thread = std::thread(&CompileWorker::run, this);
+    return true;
+}
+
+void CompileWorker::stop() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    // Programs nobody picked up; the shared namespace is still alive through the render context
+    for (Result& result : results) {
+        glDeleteSync(result.fence);
+        glDeleteProgram(result.program);
+    }
+    results.clear();
+    jobs.clear();
+    cancelled.clear();
+
+    if (context) {
+        SDL_GL_DeleteContext(context);
+        context = nullptr;
+    }
+}
+
+unsigned int CompileWorker::enqueue(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable) {
+    unsigned int id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextId++;
+        jobs.push_back(Job{ id, vertexSource, fragmentSource, retrievable });
+    }
+    wake.notify_one();
+    return id;
+}
+
+bool CompileWorker::take(unsigned int job, GLuint& program) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].id != job) {
+            continue;
+        }
+
+        // Zero timeout: only look at the fence, never block the frame
+        if (results[i].fence) {
+            GLenum status = glClientWaitSync(results[i].fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                return false;
+            }
+            glDeleteSync(results[i].fence);
+        }
+        program = results[i].program;
+        results.erase(results.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void CompileWorker::cancel(unsigned int job) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto queued = std::find_if(jobs.begin(), jobs.end(), [job](const Job& entry) { return entry.id == job; });
+    if (queued != jobs.end()) {
+        jobs.erase(queued);
+        return;
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].id == job) {
+            glDeleteSync(results[i].fence);
+            glDeleteProgram(results[i].program);
+            results.erase(results.begin() + i);
+            return;
+        }
+    }
+
+    // Currently compiling, the worker discards it when done
+    cancelled.push_back(job);
+}
+
+void CompileWorker::run() {
+    SDL_GL_MakeCurrent(window, context);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return !running || !jobs.empty(); });
+        if (!running) {
+            break;
+        }
+        Job job = jobs.front();
+        jobs.pop_front();
+
+        lock.unlock();
+        GLuint program = build(job);
+        GLsync fence = nullptr;
+        if (program != 0) {
+            // Flush so the fence reaches the GPU and can signal for the render thread
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+        lock.lock();
+
+        auto dropped = std::find(cancelled.begin(), cancelled.end(), job.id);
+        if (dropped != cancelled.end()) {
+            cancelled.erase(dropped);
+            glDeleteSync(fence);
+            glDeleteProgram(program);
+            continue;
+        }
+        results.push_back(Result{ job.id, program, fence });
+    }
+    lock.unlock();
+
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+
+GLuint CompileWorker::build(const Job& job) {
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    const char* vertexCode = job.vertexSource.c_str();
+    glShaderSource(vertexShader, 1, &vertexCode, NULL);
+    glCompileShader(vertexShader);
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    const char* fragmentCode = job.fragmentSource.c_str();
+    glShaderSource(fragmentShader, 1, &fragmentCode, NULL);
+    glCompileShader(fragmentShader);
+
+    GLuint program = 0;
+    if (checkStatus(vertexShader, false, "SHADER_COMPILATION_ERROR of type: VERTEX") &&
+        checkStatus(fragmentShader, false, "SHADER_COMPILATION_ERROR of type: FRAGMENT")) {
+        program = glCreateProgram();
+        if (job.retrievable) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        if (!checkStatus(program, true, "PROGRAM_LINKING_ERROR")) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
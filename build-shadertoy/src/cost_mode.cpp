@@ -0,0 +1,16 @@
+#include "../include/cost_mode.h"
+#include "../include/shader_cost.h"
+
+int runCostReport(const ShaderRegistry& registry, int selectedShader) {
+    std::vector<std::string> names;
+    std::vector<ShaderCost> costs;
+    for (int id = 0; id < registry.getCount(); id++) {
+        if (selectedShader >= 0 && id != selectedShader) {
+            continue;
+        }
+        names.push_back(registry.getName(id));
+        costs.push_back(estimateShaderFileCost(registry.getPath(id), registry.getDefineBlock(id)));
+    }
+    printShaderCostReport(names, costs);
+    return 0;
+}
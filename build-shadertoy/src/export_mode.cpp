@@ -0,0 +1,151 @@
+#include "../include/export_mode.h"
+#include "../include/headless_mode.h"
+#include "../include/shader_loading.h"
+#include "../include/uniform_buffer.h"
+#include "../include/frame_clock.h"
+#include "../include/render_target.h"
+#include "../include/frame_readback.h"
+#include "../include/frame_encoder.h"
+#include "../include/tiled_renderer.h"
+#include <algorithm>
+#include <thread>
+
+// Render one shader at a fixed timestep into an offscreen target and write the frames.
+// Needs a current GL context. Readback goes through a PBO ring and conversion/writing
+// through a worker pool, so the GPU keeps rendering while earlier frames are encoded.
+static int exportFrames(const Options& options, const ShaderRegistry& registry, int shader, ExportFormat format) {
+    ProgramBinaryCache cache(options.cacheDir);
+    initBinaryCache(options, cache);
+
+    TextureCache textureCache;
+    std::vector<MultipassPipeline> pipelines(registry.getCount());
+    loadShader(pipelines, registry, shader, &textureCache);
+    if (!compileShaders(pipelines, &cache)) {
+        return 1;
+    }
+
+    // iTime and iFrame advance by exactly 1/fps, independent of how long a frame takes
+    int width = options.width;
+    int height = options.height;
+    double fps = options.targetFps > 0.0 ? options.targetFps : 60.0;
+    double frameStep = 1.0 / fps;
+    int endFrame = options.startFrame + options.frames;
+
+    GLuint quadVAO = createFullScreenQuad();
+    ShaderToyGlobalsBuffer globalsBuffer;
+    globalsBuffer.init();
+    RenderTarget target;
+    FrameReadback readback;
+
+    // Poster sizes beyond the GPU's limits (or --tile) are drawn as tiles that each stay
+    // under the GPU time budget and are stitched in system memory
+    bool tiled = options.tileSize > 0 || TiledRenderer::isRequired(width, height);
+    TiledRenderer tiledRenderer;
+    if (tiled) {
+        tiledRenderer.init(options.tileSize > 0 ? options.tileSize : 256, options.tileBudgetMs);
+    }
+    else {
+        target.resize(width, height);
+        readback.init(width, height);
+    }
+
+    int threadCount = options.exportThreads;
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+    FrameEncoder encoder;
+    bool ok = encoder.start(options.exportPath, format, width, height, fps, threadCount, threadCount * 2);
+
+    // Only the day comes from the clock; the time of day follows iTime
+    float today[4];
+    getShaderToyDate(today);
+
+    std::cout << "Exporting shader " << (shader + 1) << " (" << registry.getName(shader) << "), frames "
+        << options.startFrame << "-" << (endFrame - 1) << " at " << width << "x" << height << ", " << fps
+        << " fps, " << threadCount << " encoder threads" << (tiled ? ", tiled" : "") << std::endl;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    std::vector<unsigned char> pixels;
+    int frameTag = 0;
+    for (int frame = 0; ok && frame < endFrame; frame++) {
+        double time = frame * frameStep;
+        float date[4] = { today[0], today[1], today[2], static_cast<float>(time) };
+        globalsBuffer.update(makeShaderToyGlobals(width, height, time, frameStep, frame, 0, 0, false, date));
+
+        if (tiled) {
+            // Frames before the range only need their buffer passes
+            bool keep = frame >= options.startFrame;
+            ok = tiledRenderer.render(pipelines[shader], quadVAO, width, height, keep ? &pixels : nullptr);
+            if (ok && keep) {
+                encoder.submit(frame, pixels);
+            }
+            continue;
+        }
+        pipelines[shader].render(quadVAO, width, height, target.getFramebuffer());
+
+        // Frames before the range still render: buffer passes depend on every earlier frame
+        if (frame < options.startFrame) {
+            continue;
+        }
+
+        // A full ring means the oldest copy is due; wait for it rather than drop a frame
+        while (!readback.begin(target.getFramebuffer(), frame)) {
+            if (readback.take(pixels, frameTag, true) != FrameReadback::Taken) {
+                ok = false;
+                break;
+            }
+            encoder.submit(frameTag, pixels);
+        }
+        // A lost frame would leave a gap in the output, so it fails the export
+        FrameReadback::TakeResult result;
+        while ((result = readback.take(pixels, frameTag, false)) != FrameReadback::NotReady) {
+            if (result == FrameReadback::Lost) {
+                ok = false;
+                break;
+            }
+            encoder.submit(frameTag, pixels);
+        }
+    }
+    while (ok && readback.getPending() > 0) {
+        ok = readback.take(pixels, frameTag, true) == FrameReadback::Taken;
+        if (ok) {
+            encoder.submit(frameTag, pixels);
+        }
+    }
+    ok = encoder.finish() && ok;
+
+    double elapsedMs = millisecondsSince(start);
+    std::cout << "Exported " << encoder.getWritten() << " frames to " << options.exportPath << " in "
+        << elapsedMs << " ms (" << encoder.getWritten() * 1000.0 / std::max(elapsedMs, 1.0) << " fps)" << std::endl;
+    tiledRenderer.printStats();
+    if (!ok) {
+        std::cerr << "Export failed" << std::endl;
+    }
+
+    tiledRenderer.destroy();
+    readback.destroy();
+    target.destroy();
+    globalsBuffer.destroy();
+    textureCache.destroy();
+    glDeleteVertexArrays(1, &quadVAO);
+    return ok ? 0 : 1;
+}
+
+int runExport(const Options& options, const ShaderRegistry& registry, int selectedShader) {
+    ExportFormat format = ExportFormat::PNG;
+    if (!options.exportFormat.empty()) {
+        if (!parseExportFormat(options.exportFormat, format)) {
+            std::cerr << "Unknown export format " << options.exportFormat << ", expected y4m, png or rgba" << std::endl;
+            return 1;
+        }
+    }
+    else if (!parseExportFormat(options.exportPath, format) || format != ExportFormat::Y4M) {
+        // Anything but a .y4m file is a directory for a frame sequence
+        format = ExportFormat::PNG;
+    }
+    int shader = selectedShader >= 0 ? selectedShader : 0;
+
+    return runOffscreen(options, "ShaderToy Export", [&]() {
+        return exportFrames(options, registry, shader, format);
+    });
+}
@@ -0,0 +1,168 @@
+#include "../include/frame_capture.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+
+// Readbacks in flight; a frame is normally picked up one or two frames after it was queued
+static const int RING_SIZE = 4;
+
+// Frames that may wait for the recording encoder before new ones are dropped
+static const int RECORDING_QUEUE = 8;
+
+std::string timestampNow() {
+    std::time_t now = std::time(nullptr);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y%m%d-%H%M%S", std::localtime(&now));
+    return text;
+}
+
+FrameCapture::FrameCapture()
+    : directory("../captures"), recordingFps(60.0), screenshotRequested(false), recording(false), recordingCount(0),
+      screenshots(0), recordedFrames(0), droppedFrames(0), captureCalls(0), captureTotalMs(0.0), captureMaxMs(0.0) {
+}
+
+FrameCapture::~FrameCapture() {
+    shutdown();
+}
+
+bool FrameCapture::startRecording(double fps) {
+    if (recording) {
+        return true;
+    }
+    if (sessionName.empty()) {
+        sessionName = timestampNow();
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = directory + "/recording_" + sessionName + "_" + std::to_string(++recordingCount) + ".y4m";
+
+    // The size is fixed for the whole file, it is taken from the first captured frame
+    recording = true;
+    recordingPath = path;
+    recordingFps = fps;
+    std::cout << "Recording to " << path << std::endl;
+    return true;
+}
+
+void FrameCapture::stopRecording() {
+    if (!recording) {
+        return;
+    }
+    // Frames already read back still belong to the recording
+    deliver(true);
+    recording = false;
+    recordingPath.clear();
+    if (recordingEncoder.isRunning()) {
+        recordingEncoder.finish();
+    }
+    std::cout << "Recording stopped (" << recordedFrames << " frames recorded, " << droppedFrames << " dropped so far)"
+        << std::endl;
+}
+
+void FrameCapture::capture(int width, int height, int frame) {
+    if (!screenshotRequested && !recording && readback.getPending() == 0) {
+        return;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // A new window size needs new buffers; only happens on a resize, so waiting is fine
+    if (readback.getWidth() != width || readback.getHeight() != height) {
+        deliver(true);
+        screenshotEncoder.finish();
+        if (recording && recordingEncoder.isRunning()) {
+            std::cout << "Window resized, recording stopped" << std::endl;
+            stopRecording();
+        }
+        readback.init(width, height, RING_SIZE);
+    }
+
+    // The Y4M file starts with the first frame, at the size it has
+    if (recording && !recordingEncoder.isRunning()) {
+        if (!recordingEncoder.start(recordingPath, ExportFormat::Y4M, width, height, recordingFps, 1, RECORDING_QUEUE)) {
+            recording = false;
+        }
+    }
+
+    // Free ring slots first, then queue this frame
+    deliver(false);
+    int kind = (screenshotRequested ? Screenshot : 0) | (recording ? Recording : 0);
+    if (kind != 0) {
+        if (readback.begin(0, frame)) {
+            kinds.push_back(kind);
+            screenshotRequested = false;
+        }
+        else if (recording) {
+            // A screenshot request simply waits for the next frame
+            droppedFrames++;
+        }
+    }
+
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    captureCalls++;
+    captureTotalMs += ms;
+    captureMaxMs = std::max(captureMaxMs, ms);
+}
+
+void FrameCapture::deliver(bool wait) {
+    int frame = 0;
+    FrameReadback::TakeResult result;
+    while ((result = readback.take(pixels, frame, wait)) != FrameReadback::NotReady) {
+        // Every used-up slot has its flags, even one whose pixels were lost
+        int kind = kinds.front();
+        kinds.pop_front();
+        if (result == FrameReadback::Lost) {
+            if (kind & Recording) {
+                droppedFrames++;
+            }
+            continue;
+        }
+
+        if (kind & Screenshot) {
+            if (!screenshotEncoder.isRunning()) {
+                if (sessionName.empty()) {
+                    sessionName = timestampNow();
+                }
+                screenshotEncoder.start(directory, ExportFormat::PNG, readback.getWidth(), readback.getHeight(), 0.0,
+                    1, 4, "screenshot_" + sessionName + "_");
+            }
+            // Recorded too: the recording gets the original, the screenshot a copy
+            std::vector<unsigned char> shot = (kind & Recording) ? pixels : std::vector<unsigned char>();
+            std::vector<unsigned char>& source = (kind & Recording) ? shot : pixels;
+            if (screenshotEncoder.submit(frame, source, false)) {
+                screenshots++;
+                std::cout << "Screenshot of frame " << frame << " queued for " << directory << std::endl;
+            }
+            else {
+                std::cerr << "Screenshot of frame " << frame << " dropped, encoder busy" << std::endl;
+            }
+        }
+        if ((kind & Recording) && recording && recordingEncoder.isRunning()) {
+            if (recordingEncoder.submit(frame, pixels, false)) {
+                recordedFrames++;
+            }
+            else {
+                droppedFrames++;
+            }
+        }
+    }
+}
+
+void FrameCapture::shutdown() {
+    if (recording) {
+        stopRecording();
+    }
+    deliver(true);
+    kinds.clear();
+    screenshotEncoder.finish();
+    readback.destroy();
+}
+
+void FrameCapture::printStats() const {
+    if (captureCalls == 0) {
+        return;
+    }
+    std::cout << "Capture: " << screenshots << " screenshots, " << recordedFrames << " frames recorded, "
+        << droppedFrames << " dropped; capture() mean " << captureTotalMs / captureCalls << " ms, max "
+        << captureMaxMs << " ms over " << captureCalls << " frames" << std::endl;
+}
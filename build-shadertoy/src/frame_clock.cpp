@@ -0,0 +1,85 @@
+#include "../include/frame_clock.h"
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+FrameClock::FrameClock()
+    : wrapMode(TimeWrap::None), period(0.0), time(0.0), delta(0.0), rebaseOrigin(0.0),
+      rebased(false), paused(false), scale(1.0), pendingStep(0.0) {
+    secondsPerTick = 1.0 / SDL_GetPerformanceFrequency();
+    lastCounter = SDL_GetPerformanceCounter();
+}
+
+void FrameClock::configure(TimeWrap mode, double periodSeconds) {
+    wrapMode = periodSeconds > 0.0 ? mode : TimeWrap::None;
+    period = periodSeconds;
+    rebaseOrigin = time;
+}
+
+double FrameClock::tick() {
+    Uint64 counter = SDL_GetPerformanceCounter();
+    double elapsed = (counter - lastCounter) * secondsPerTick;
+    lastCounter = counter;
+
+    if (paused) {
+        delta = pendingStep;
+        pendingStep = 0.0;
+    }
+    else {
+        delta = elapsed * scale;
+    }
+    time += delta;
+
+    if (wrapMode == TimeWrap::Rebase && time - rebaseOrigin >= period) {
+        rebaseOrigin = time;
+        rebased = true;
+    }
+    return delta;
+}
+
+double FrameClock::getShaderTime() const {
+    switch (wrapMode) {
+        case TimeWrap::Wrap: return std::fmod(time, period);
+        case TimeWrap::Rebase: return time - rebaseOrigin;
+        case TimeWrap::None: break;
+    }
+    return time;
+}
+
+bool FrameClock::consumeRebase() {
+    bool result = rebased;
+    rebased = false;
+    return result;
+}
+
+void FrameClock::setPaused(bool paused) {
+    this->paused = paused;
+    pendingStep = 0.0;
+}
+
+void FrameClock::setScale(double scale) {
+    this->scale = scale > 0.0 ? scale : 0.0;
+}
+
+void FrameClock::step(double seconds) {
+    if (paused) {
+        pendingStep += seconds;
+    }
+}
+
+void getShaderToyDate(float date[4]) {
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    double fraction = std::chrono::duration<double>(now.time_since_epoch()).count() - static_cast<double>(seconds);
+
+    date[0] = static_cast<float>(local.tm_year + 1900);
+    date[1] = static_cast<float>(local.tm_mon);
+    date[2] = static_cast<float>(local.tm_mday);
+    date[3] = static_cast<float>(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec + fraction);
+}
@@ -0,0 +1,268 @@
+#include "../include/frame_encoder.h"
+#include "../../SDL/SDL_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+
+bool parseExportFormat(const std::string& name, ExportFormat& format) {
+    std::string extension = name.substr(name.find_last_of('.') + 1);
+    if (extension == "y4m") {
+        format = ExportFormat::Y4M;
+    }
+    else if (extension == "rgba") {
+        format = ExportFormat::RawRGBA;
+    }
+    else if (extension == "png") {
+        format = ExportFormat::PNG;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// Full-range BT.601 (JFIF) in 8.8 fixed point. The chroma sums get +128 << 8 before
+// the shift so they never go negative.
+static inline unsigned char lumaOf(int r, int g, int b) {
+    return static_cast<unsigned char>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+static inline unsigned char blueDifferenceOf(int r, int g, int b) {
+    return static_cast<unsigned char>((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+}
+
+static inline unsigned char redDifferenceOf(int r, int g, int b) {
+    return static_cast<unsigned char>((128 * r - 107 * g - 21 * b + 32896) >> 8);
+}
+
+// Planar 4:2:0 (Y, then Cb, then Cr; chroma averaged over 2x2 blocks) from RGBA
+// stored bottom row first
+static void convertToI420(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& yuv) {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    yuv.resize(static_cast<size_t>(width) * height + 2 * static_cast<size_t>(chromaWidth) * chromaHeight);
+    unsigned char* lumaPlane = yuv.data();
+    unsigned char* blueRows = lumaPlane + static_cast<size_t>(width) * height;
+    unsigned char* redRows = blueRows + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = rgba + static_cast<size_t>(height - 1 - y) * width * 4;
+        unsigned char* dst = lumaPlane + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            dst[x] = lumaOf(src[x * 4 + 0], src[x * 4 + 1], src[x * 4 + 2]);
+        }
+    }
+
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        // Edge rows / columns of odd sizes reuse the last pixel
+        int y0 = cy * 2;
+        int y1 = std::min(y0 + 1, height - 1);
+        const unsigned char* row0 = rgba + static_cast<size_t>(height - 1 - y0) * width * 4;
+        const unsigned char* row1 = rgba + static_cast<size_t>(height - 1 - y1) * width * 4;
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int x0 = cx * 2 * 4;
+            int x1 = std::min(cx * 2 + 1, width - 1) * 4;
+            int r = (row0[x0 + 0] + row0[x1 + 0] + row1[x0 + 0] + row1[x1 + 0] + 2) >> 2;
+            int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) >> 2;
+            int b = (row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2] + 2) >> 2;
+            blueRows[static_cast<size_t>(cy) * chromaWidth + cx] = blueDifferenceOf(r, g, b);
+            redRows[static_cast<size_t>(cy) * chromaWidth + cx] = redDifferenceOf(r, g, b);
+        }
+    }
+}
+
+FrameEncoder::FrameEncoder()
+    : format(ExportFormat::PNG), width(0), height(0), maxQueued(1), nextSequence(0), written(0),
+      running(false), failed(false), nextToWrite(0) {
+}
+
+FrameEncoder::~FrameEncoder() {
+    finish();
+}
+
+bool FrameEncoder::start(const std::string& outputPath, ExportFormat outputFormat, int w, int h, double fps,
+    int threadCount, int queueLimit, const std::string& prefix) {
+    finish();
+
+    path = outputPath;
+    namePrefix = prefix;
+    format = outputFormat;
+    width = w;
+    height = h;
+    maxQueued = std::max(queueLimit, 1);
+    nextSequence = 0;
+    nextToWrite = 0;
+    written = 0;
+    failed = false;
+    converted.clear();
+
+    if (format == ExportFormat::Y4M) {
+        stream.clear();
+        stream.open(path, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            std::cerr << "Could not open " << path << " for writing!" << std::endl;
+            return false;
+        }
+        // Frame rate as a ratio, e.g. 29.97 -> 2997:100
+        long numerator = std::lround(fps * 1000.0);
+        long denominator = 1000;
+        long divisor = std::gcd(numerator, denominator);
+        stream << "YUV4MPEG2 W" << width << " H" << height << " F" << numerator / divisor << ":" << denominator / divisor
+            << " Ip A1:1 C420jpeg\n";
+    }
+    else {
+        std::error_code error;
+        std::filesystem::create_directories(path, error);
+        if (error) {
+            std::cerr << "Could not create " << path << ": " << error.message() << std::endl;
+            return false;
+        }
+    }
+
+    running = true;
+    for (int i = 0; i < std::max(threadCount, 1); i++) {
+        workers.push_back(std::thread(&FrameEncoder::run, this));
+    }
+    return true;
+}
+
+bool FrameEncoder::submit(int frameNumber, std::vector<unsigned char>& pixels, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!wait && static_cast<int>(jobs.size()) >= maxQueued) {
+        return false;
+    }
+    room.wait(lock, [this] { return static_cast<int>(jobs.size()) < maxQueued; });
+
+    Job job;
+    job.sequence = nextSequence++;
+    job.frameNumber = frameNumber;
+    job.pixels.swap(pixels);
+    if (!freeBuffers.empty()) {
+        pixels.swap(freeBuffers.back());
+        freeBuffers.pop_back();
+    }
+    jobs.push_back(std::move(job));
+    lock.unlock();
+    wake.notify_one();
+    return true;
+}
+
+bool FrameEncoder::finish() {
+    if (workers.empty()) {
+        return !failed;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    freeBuffers.clear();
+
+    if (stream.is_open()) {
+        stream.close();
+        if (!stream) {
+            failed = true;
+        }
+    }
+    return !failed;
+}
+
+int FrameEncoder::getWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return written;
+}
+
+void FrameEncoder::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Queued frames are still written after finish() was called
+        wake.wait(lock, [this] { return !running || !jobs.empty(); });
+        if (jobs.empty()) {
+            break;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        room.notify_one();
+
+        lock.unlock();
+        bool ok = encode(job);
+        lock.lock();
+
+        if (ok) {
+            written++;
+        }
+        else {
+            failed = true;
+        }
+        freeBuffers.push_back(std::move(job.pixels));
+    }
+}
+
+bool FrameEncoder::encode(Job& job) {
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+
+    if (format == ExportFormat::Y4M) {
+        std::vector<unsigned char> yuv;
+        convertToI420(job.pixels.data(), width, height, yuv);
+
+        // Whoever holds the lock writes every frame that is now next in line
+        std::lock_guard<std::mutex> lock(writeMutex);
+        converted[job.sequence].swap(yuv);
+        while (!converted.empty() && converted.begin()->first == nextToWrite) {
+            const std::vector<unsigned char>& frame = converted.begin()->second;
+            stream << "FRAME\n";
+            stream.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+            converted.erase(converted.begin());
+            nextToWrite++;
+        }
+        return stream.good();
+    }
+
+    if (format == ExportFormat::RawRGBA) {
+        std::string filePath = framePath(job.frameNumber, "rgba");
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        for (int y = height - 1; y >= 0; y--) {
+            file.write(reinterpret_cast<const char*>(&job.pixels[y * rowBytes]), static_cast<std::streamsize>(rowBytes));
+        }
+        if (!file) {
+            std::cerr << "Could not write " << filePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        std::cerr << "Could not create a surface for frame " << job.frameNumber << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    for (int y = 0; y < height; y++) {
+        unsigned char* dst = static_cast<unsigned char*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch;
+        std::memcpy(dst, &job.pixels[(height - 1 - y) * rowBytes], rowBytes);
+        // ShaderToy ignores alpha; keep the image opaque
+        for (int x = 0; x < width; x++) {
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    std::string filePath = framePath(job.frameNumber, "png");
+    bool ok = IMG_SavePNG(surface, filePath.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "Could not write " << filePath << ": " << IMG_GetError() << std::endl;
+    }
+    SDL_FreeSurface(surface);
+    return ok;
+}
+
+std::string FrameEncoder::framePath(int frameNumber, const char* extension) const {
+    char number[32];
+    snprintf(number, sizeof(number), "%06d.%s", frameNumber, extension);
+    return path + "/" + namePrefix + number;
+}
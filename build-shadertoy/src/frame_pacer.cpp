@@ -0,0 +1,124 @@
+#include "../include/frame_pacer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+const char* getSwapModeName(SwapMode mode) {
+    switch (mode) {
+        case SwapMode::VSync: return "vsync";
+        case SwapMode::AdaptiveVSync: return "adaptive vsync";
+        case SwapMode::FreeRunning: return "free running";
+    }
+    return "unknown";
+}
+
+FramePacer::FramePacer()
+    : swapMode(SwapMode::VSync), targetRate(0.0), period(0), deadline(0), lastFrameMs(0.0),
+      intervals(HISTORY_SIZE, 0.0), next(0), count(0) {
+    tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+    lastFrame = 0;
+}
+
+bool FramePacer::setSwapMode(SwapMode mode) {
+    int interval = 1;
+    if (mode == SwapMode::AdaptiveVSync) {
+        interval = -1;
+    }
+    else if (mode == SwapMode::FreeRunning) {
+        interval = 0;
+    }
+
+    if (SDL_GL_SetSwapInterval(interval) != 0) {
+        if (mode == SwapMode::AdaptiveVSync && SDL_GL_SetSwapInterval(1) == 0) {
+            std::cerr << "Adaptive vsync not supported, using vsync" << std::endl;
+            mode = SwapMode::VSync;
+        }
+        else {
+            std::cerr << "Could not set swap interval " << interval << ": " << SDL_GetError() << std::endl;
+            return false;
+        }
+    }
+    swapMode = mode;
+    return true;
+}
+
+void FramePacer::setTargetRate(double framesPerSecond) {
+    targetRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+    period = targetRate > 0.0 ? static_cast<Uint64>(SDL_GetPerformanceFrequency() / targetRate) : 0;
+    deadline = SDL_GetPerformanceCounter() + period;
+}
+
+void FramePacer::wait() {
+    if (period > 0) {
+        Uint64 now = SDL_GetPerformanceCounter();
+
+        // More than a period behind (stall, breakpoint): start over instead of
+        // rushing frames out to catch up
+        if (now > deadline + period) {
+            deadline = now;
+        }
+
+        // Coarse sleep, then spin the last couple of milliseconds
+        double remainingMs = (static_cast<double>(deadline) - static_cast<double>(now)) * tickMs;
+        if (remainingMs > SPIN_MARGIN_MS) {
+            SDL_Delay(static_cast<Uint32>(remainingMs - SPIN_MARGIN_MS));
+        }
+        while (SDL_GetPerformanceCounter() < deadline) {
+            std::this_thread::yield();
+        }
+        deadline += period;
+    }
+
+    // The first call only starts the clock, startup time is not a frame
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastFrame == 0) {
+        lastFrame = now;
+        return;
+    }
+    lastFrameMs = (now - lastFrame) * tickMs;
+    lastFrame = now;
+
+    intervals[next] = lastFrameMs;
+    next = (next + 1) % HISTORY_SIZE;
+    if (count < HISTORY_SIZE) {
+        count++;
+    }
+}
+
+FrameStats FramePacer::getStats() const {
+    FrameStats stats;
+    if (count == 0) {
+        return stats;
+    }
+
+    std::vector<double> sorted(intervals.begin(), intervals.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (double interval : sorted) {
+        total += interval;
+    }
+    stats.count = count;
+    stats.mean = total / count;
+
+    double variance = 0.0;
+    for (double interval : sorted) {
+        variance += (interval - stats.mean) * (interval - stats.mean);
+    }
+    stats.jitter = std::sqrt(variance / count);
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.p99 = sorted[std::max(static_cast<int>(std::ceil(0.99 * count)), 1) - 1];
+    return stats;
+}
+
+void FramePacer::printStats() const {
+    FrameStats stats = getStats();
+    std::cout << "Frame pacing (" << getSwapModeName(swapMode);
+    if (targetRate > 0.0) {
+        std::cout << ", limited to " << targetRate << " fps";
+    }
+    std::cout << "): mean " << stats.mean << " ms, jitter " << stats.jitter << " ms, min "
+        << stats.min << " ms, p99 " << stats.p99 << " ms, max " << stats.max << " ms over "
+        << stats.count << " frames" << std::endl;
+}
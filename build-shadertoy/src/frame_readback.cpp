@@ -0,0 +1,106 @@
+#include "../include/frame_readback.h"
+#include <cstring>
+
+// How long take(wait = true) blocks on one fence before giving up
+static const GLuint64 WAIT_TIMEOUT_NS = 1000000000ULL;
+
+FrameReadback::FrameReadback() : head(0), tail(0), pending(0), width(0), height(0) {
+}
+
+FrameReadback::~FrameReadback() {
+    destroy();
+}
+
+bool FrameReadback::init(int w, int h, int ringSize) {
+    destroy();
+    if (w <= 0 || h <= 0 || ringSize <= 0) {
+        return false;
+    }
+
+    width = w;
+    height = h;
+    ring.resize(ringSize);
+    for (Slot& slot : ring) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, NULL, GL_STREAM_READ);
+        slot.fence = nullptr;
+        slot.tag = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void FrameReadback::destroy() {
+    for (Slot& slot : ring) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    ring.clear();
+    head = 0;
+    tail = 0;
+    pending = 0;
+    width = 0;
+    height = 0;
+}
+
+bool FrameReadback::begin(GLuint framebuffer, int frameTag) {
+    if (ring.empty() || pending == static_cast<int>(ring.size())) {
+        return false;
+    }
+
+    Slot& slot = ring[head];
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(framebuffer != 0 ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    // With a pack buffer bound the last argument is an offset and the call returns at once
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.tag = frameTag;
+    head = (head + 1) % ring.size();
+    pending++;
+    return true;
+}
+
+FrameReadback::TakeResult FrameReadback::take(std::vector<unsigned char>& pixels, int& frameTag, bool wait) {
+    if (pending == 0) {
+        return NotReady;
+    }
+
+    Slot& slot = ring[tail];
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? WAIT_TIMEOUT_NS : 0);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        if (wait) {
+            std::cerr << "Frame readback did not complete" << std::endl;
+        }
+        return NotReady;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    size_t size = static_cast<size_t>(width) * height * 4;
+    pixels.resize(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+    bool ok = mapped != nullptr;
+    if (ok) {
+        std::memcpy(pixels.data(), mapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        std::cerr << "Could not map the readback buffer" << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frameTag = slot.tag;
+    tail = (tail + 1) % ring.size();
+    pending--;
+    return ok ? Taken : Lost;
+}
@@ -0,0 +1,107 @@
+#include "../include/golden.h"
+#include "../../SDL/SDL_image.h"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+std::string goldenImagePath(const std::string& directory, const std::string& shaderName, int width, int height) {
+    // Registry names may contain spaces and other characters unfit for file names
+    std::string name = shaderName;
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    return directory + "/" + name + "_" + std::to_string(width) + "x" + std::to_string(height) + ".png";
+}
+
+bool saveGoldenImage(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        std::cerr << "Could not create a surface for " << path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    for (int y = 0; y < height; y++) {
+        unsigned char* dst = static_cast<unsigned char*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch;
+        std::memcpy(dst, &pixels[(height - 1 - y) * rowBytes], rowBytes);
+        // Alpha is not compared; keep references opaque
+        for (int x = 0; x < width; x++) {
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    bool ok = IMG_SavePNG(surface, path.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "Could not write " << path << ": " << IMG_GetError() << std::endl;
+    }
+    SDL_FreeSurface(surface);
+    return ok;
+}
+
+bool loadGoldenImage(const std::string& path, int width, int height, std::vector<unsigned char>& pixels) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (!loaded) {
+        return false;
+    }
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!surface) {
+        return false;
+    }
+    bool ok = surface->w == width && surface->h == height;
+    if (ok) {
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+        pixels.resize(rowBytes * height);
+        for (int y = 0; y < height; y++) {
+            const unsigned char* src = static_cast<const unsigned char*>(surface->pixels) +
+                static_cast<size_t>(y) * surface->pitch;
+            std::memcpy(&pixels[(height - 1 - y) * rowBytes], src, rowBytes);
+        }
+    }
+    else {
+        std::cerr << path << " is " << surface->w << "x" << surface->h << ", expected " << width << "x" << height
+            << std::endl;
+    }
+    SDL_FreeSurface(surface);
+    return ok;
+}
+
+bool printGoldenReport(const std::vector<GoldenResult>& results, double minPsnr) {
+    static const char* statusNames[] = { "ok", "FAILED", "MISSING", "updated", "ERROR" };
+
+    int problems = 0;
+    double compareMs = 0.0;
+    std::cout << std::fixed;
+    for (const GoldenResult& result : results) {
+        std::string size = std::to_string(result.width) + "x" + std::to_string(result.height);
+        std::cout << "  " << std::left << std::setw(20) << result.shader << " " << std::setw(10) << size << std::right
+            << " " << std::setw(8) << statusNames[result.status];
+        if (result.status == GoldenResult::Passed || result.status == GoldenResult::Failed) {
+            std::cout << "  PSNR ";
+            if (std::isinf(result.quality.psnr)) {
+                std::cout << "  exact";
+            }
+            else {
+                std::cout << std::setprecision(2) << std::setw(7) << result.quality.psnr;
+            }
+            std::cout << " dB  SSIM " << std::setprecision(5) << result.quality.ssim;
+        }
+        if (result.gpuMs >= 0.0) {
+            std::cout << "  GPU " << std::setprecision(3) << result.gpuMs << " ms";
+        }
+        std::cout << std::endl;
+
+        compareMs += result.compareMs;
+        if (result.status == GoldenResult::Failed || result.status == GoldenResult::Missing ||
+            result.status == GoldenResult::Error) {
+            problems++;
+        }
+    }
+    std::cout << std::setprecision(1) << results.size() << " images, " << problems << " problems (limits: PSNR "
+        << minPsnr << " dB, SSIM " << std::setprecision(2) << GOLDEN_MIN_SSIM << "), comparing took "
+        << std::setprecision(1) << compareMs << " ms" << (hasSimdImageCompare() ? " (SSE2)" : "") << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    return problems == 0;
+}
@@ -0,0 +1,147 @@
+#include "../include/golden_mode.h"
+#include "../include/headless_mode.h"
+#include "../include/shader_loading.h"
+#include "../include/golden.h"
+#include "../include/gpu_profiler.h"
+#include "../include/uniform_buffer.h"
+#include "../include/render_target.h"
+#include "../include/frame_readback.h"
+#include <filesystem>
+
+// Render one golden image of a compiled pipeline into pixels (see GOLDEN_FRAME).
+// Returns the GPU time of the final frame, -1 if it was not measured.
+static double renderGoldenImage(MultipassPipeline& pipeline, GLuint quadVAO, ShaderToyGlobalsBuffer& globalsBuffer,
+    GpuProfiler& profiler, int width, int height, std::vector<unsigned char>& pixels) {
+    RenderTarget target;
+    target.resize(width, height);
+    pipeline.resetBuffers();
+
+    // A fixed day, so shaders reading iDate render the same image on every run
+    double frameStep = 1.0 / GOLDEN_FPS;
+    int mouseX = static_cast<int>(GOLDEN_MOUSE_X * width);
+    int mouseY = static_cast<int>(GOLDEN_MOUSE_Y * height);
+
+    // Without buffer passes no earlier frame can change the result
+    int firstFrame = pipeline.getBufferCount() > 0 ? 0 : GOLDEN_FRAME;
+    for (int frame = firstFrame; frame <= GOLDEN_FRAME; frame++) {
+        double time = frame * frameStep;
+        float date[4] = { 2024.0f, 0.0f, 1.0f, static_cast<float>(time) };
+        globalsBuffer.update(makeShaderToyGlobals(width, height, time, frameStep, frame, mouseX, mouseY, true, date));
+        if (frame == GOLDEN_FRAME) {
+            profiler.begin(0);
+        }
+        pipeline.render(quadVAO, width, height, target.getFramebuffer());
+        if (frame == GOLDEN_FRAME) {
+            profiler.end();
+        }
+    }
+
+    FrameReadback readback;
+    readback.init(width, height, 1);
+    readback.begin(target.getFramebuffer(), GOLDEN_FRAME);
+    int tag = 0;
+    if (readback.take(pixels, tag, true) != FrameReadback::Taken) {
+        pixels.clear();
+    }
+    readback.destroy();
+    target.destroy();
+
+    double gpuMs = -1.0;
+    double sample = 0.0;
+    while (profiler.fetch(tag, sample)) {
+        gpuMs = sample;
+    }
+    return gpuMs;
+}
+
+int runGolden(const Options& options, const ShaderRegistry& registry, int selectedShader) {
+    std::vector<std::pair<int, int>> sizes;
+    std::stringstream list(options.goldenSizes);
+    std::string size;
+    while (std::getline(list, size, ',')) {
+        size_t x = size.find('x');
+        int width = x != std::string::npos ? std::atoi(size.substr(0, x).c_str()) : 0;
+        int height = x != std::string::npos ? std::atoi(size.substr(x + 1).c_str()) : 0;
+        if (width <= 0 || height <= 0) {
+            std::cerr << "Invalid size in --golden-sizes: " << size << std::endl;
+            return 1;
+        }
+        sizes.push_back({ width, height });
+    }
+
+    if (options.goldenUpdate) {
+        std::error_code error;
+        std::filesystem::create_directories(options.goldenDir, error);
+    }
+
+    return runOffscreen(options, "ShaderToy Golden Images", [&]() {
+        ProgramBinaryCache cache(options.cacheDir);
+        initBinaryCache(options, cache);
+        GLuint quadVAO = createFullScreenQuad();
+        ShaderToyGlobalsBuffer globalsBuffer;
+        globalsBuffer.init();
+        GpuProfiler profiler;
+        profiler.init(1, 4, 1);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        std::vector<GoldenResult> results;
+        std::vector<unsigned char> pixels;
+        std::vector<unsigned char> reference;
+        for (int shader = 0; shader < registry.getCount(); shader++) {
+            if (selectedShader >= 0 && shader != selectedShader) {
+                continue;
+            }
+
+            // One shader at a time keeps memory flat for large registries
+            TextureCache textureCache;
+            std::vector<MultipassPipeline> pipelines(registry.getCount());
+            loadShader(pipelines, registry, shader, &textureCache);
+            bool compiled = compileShaders(pipelines, &cache);
+
+            for (const auto& entry : sizes) {
+                GoldenResult result;
+                result.shader = registry.getName(shader);
+                result.width = entry.first;
+                result.height = entry.second;
+                if (!compiled) {
+                    results.push_back(result);
+                    continue;
+                }
+
+                result.gpuMs = renderGoldenImage(pipelines[shader], quadVAO, globalsBuffer, profiler,
+                    result.width, result.height, pixels);
+                std::string path = goldenImagePath(options.goldenDir, result.shader, result.width, result.height);
+                if (pixels.empty()) {
+                    result.status = GoldenResult::Error;
+                }
+                else if (options.goldenUpdate) {
+                    result.status = saveGoldenImage(path, result.width, result.height, pixels) ?
+                        GoldenResult::Updated : GoldenResult::Error;
+                }
+                else if (!loadGoldenImage(path, result.width, result.height, reference)) {
+                    result.status = GoldenResult::Missing;
+                }
+                else {
+                    Uint64 compareStart = SDL_GetPerformanceCounter();
+                    result.quality = compareImages(pixels.data(), reference.data(), result.width, result.height);
+                    result.compareMs = millisecondsSince(compareStart);
+                    bool close = result.quality.psnr >= options.goldenMinPsnr &&
+                        result.quality.ssim >= GOLDEN_MIN_SSIM;
+                    result.status = close ? GoldenResult::Passed : GoldenResult::Failed;
+                }
+                results.push_back(result);
+            }
+            textureCache.destroy();
+        }
+
+        profiler.destroy();
+        globalsBuffer.destroy();
+        glDeleteVertexArrays(1, &quadVAO);
+
+        std::cout << "Golden images in " << options.goldenDir << " (frame " << GOLDEN_FRAME << ", "
+            << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << "):" << std::endl;
+        bool ok = printGoldenReport(results, options.goldenMinPsnr);
+        std::cout << "Sweep took " << millisecondsSince(start) << " ms" << std::endl;
+        return ok ? 0 : 1;
+    });
+}
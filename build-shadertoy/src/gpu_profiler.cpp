@@ -0,0 +1,183 @@
+#include "../include/gpu_profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+GpuProfiler::GpuProfiler() : historySize(0), head(0), tail(0), pending(0), active(false), dropped(0) {
+}
+
+GpuProfiler::~GpuProfiler() {
+    destroy();
+}
+
+bool GpuProfiler::init(int tagCount, int ringSize, int historySize) {
+    destroy();
+
+    // A zero-bit counter means timestamps are not implemented
+    GLint counterBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    if (counterBits == 0) {
+        std::cerr << "GPU profiler disabled: no timestamp query support" << std::endl;
+        return false;
+    }
+
+    ring.resize(ringSize);
+    for (Span& span : ring) {
+        GLuint queries[2];
+        glGenQueries(2, queries);
+        span.start = queries[0];
+        span.end = queries[1];
+        span.tag = -1;
+    }
+
+    this->historySize = historySize;
+    // Sample storage is allocated on a tag's first sample, most shaders are never timed
+    history.assign(tagCount, History());
+    return true;
+}
+
+void GpuProfiler::destroy() {
+    for (Span& span : ring) {
+        GLuint queries[2] = { span.start, span.end };
+        glDeleteQueries(2, queries);
+    }
+    ring.clear();
+    history.clear();
+    head = tail = pending = 0;
+    active = false;
+    dropped = 0;
+}
+
+void GpuProfiler::begin(int tag) {
+    if (ring.empty() || active || tag < 0 || tag >= static_cast<int>(history.size())) {
+        return;
+    }
+    if (pending == static_cast<int>(ring.size())) {
+        dropped++;
+        return;
+    }
+    ring[head].tag = tag;
+    glQueryCounter(ring[head].start, GL_TIMESTAMP);
+    active = true;
+}
+
+void GpuProfiler::end() {
+    if (!active) {
+        return;
+    }
+    glQueryCounter(ring[head].end, GL_TIMESTAMP);
+    head = (head + 1) % ring.size();
+    pending++;
+    active = false;
+}
+
+bool GpuProfiler::fetch(int& tag, double& milliseconds) {
+    if (pending == 0) {
+        return false;
+    }
+
+    // Timestamps complete in order, so the end query being ready covers the start
+    const Span& span = ring[tail];
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(span.end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+
+    GLuint64 startNs = 0;
+    GLuint64 endNs = 0;
+    glGetQueryObjectui64v(span.start, GL_QUERY_RESULT, &startNs);
+    glGetQueryObjectui64v(span.end, GL_QUERY_RESULT, &endNs);
+    tail = (tail + 1) % ring.size();
+    pending--;
+
+    tag = span.tag;
+    milliseconds = endNs > startNs ? (endNs - startNs) / 1.0e6 : 0.0;
+
+    History& tagHistory = history[tag];
+    if (tagHistory.samples.empty()) {
+        tagHistory.samples.resize(historySize);
+    }
+    tagHistory.samples[tagHistory.next] = milliseconds;
+    tagHistory.next = (tagHistory.next + 1) % historySize;
+    if (tagHistory.count < historySize) {
+        tagHistory.count++;
+    }
+    return true;
+}
+
+void GpuProfiler::collect() {
+    int tag = 0;
+    double milliseconds = 0.0;
+    while (fetch(tag, milliseconds)) {
+    }
+}
+
+GpuStats GpuProfiler::getStats(int tag) const {
+    GpuStats stats;
+    if (tag < 0 || tag >= static_cast<int>(history.size()) || history[tag].count == 0) {
+        return stats;
+    }
+
+    const History& tagHistory = history[tag];
+    std::vector<double> sorted(tagHistory.samples.begin(), tagHistory.samples.begin() + tagHistory.count);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (double sample : sorted) {
+        total += sample;
+    }
+
+    // Nearest-rank percentiles
+    auto percentile = [&sorted](double p) {
+        int rank = static_cast<int>(std::ceil(p * sorted.size()));
+        return sorted[std::max(rank, 1) - 1];
+    };
+
+    stats.count = tagHistory.count;
+    stats.mean = total / sorted.size();
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.max = sorted.back();
+    return stats;
+}
+
+void GpuProfiler::dump(const std::vector<std::string>& names) const {
+    std::vector<int> order;
+    for (int tag = 0; tag < static_cast<int>(history.size()); tag++) {
+        if (history[tag].count > 0) {
+            order.push_back(tag);
+        }
+    }
+    if (order.empty()) {
+        std::cout << "GPU profile: no samples yet" << std::endl;
+        return;
+    }
+
+    std::vector<GpuStats> stats(history.size());
+    for (int tag : order) {
+        stats[tag] = getStats(tag);
+    }
+    std::sort(order.begin(), order.end(), [&stats](int a, int b) { return stats[a].mean > stats[b].mean; });
+
+    std::cout << "GPU profile (ms over the last " << historySize << " frames, most expensive first):" << std::endl;
+    std::ios oldState(nullptr);
+    oldState.copyfmt(std::cout);
+    std::cout << std::fixed << std::setprecision(3);
+    for (int tag : order) {
+        const GpuStats& s = stats[tag];
+        std::string name = tag < static_cast<int>(names.size()) ? names[tag] : std::to_string(tag);
+        std::cout << "  " << std::left << std::setw(24) << name << std::right
+            << " mean " << std::setw(8) << s.mean
+            << "  p50 " << std::setw(8) << s.p50
+            << "  p95 " << std::setw(8) << s.p95
+            << "  p99 " << std::setw(8) << s.p99
+            << "  max " << std::setw(8) << s.max
+            << "  (" << s.count << " samples)" << std::endl;
+    }
+    std::cout.copyfmt(oldState);
+    if (dropped > 0) {
+        std::cout << "  " << dropped << " spans skipped while the query ring was full" << std::endl;
+    }
+}
@@ -0,0 +1,118 @@
+#include "../include/headless_context.h"
+
+#ifdef SHADERTOY_OSMESA
+
+HeadlessContext::HeadlessContext() : context(nullptr), width(0), height(0) {
+}
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+bool HeadlessContext::isSupported() {
+    return true;
+}
+
+bool HeadlessContext::create(int w, int h) {
+    destroy();
+
+    // Same context version/profile the windowed renderer asks SDL for
+    const int attribs[] = {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 0,
+        OSMESA_STENCIL_BITS, 0,
+        OSMESA_ACCUM_BITS, 0,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+
+    context = OSMesaCreateContextAttribs(attribs, NULL);
+    if (!context) {
+        std::cerr << "OSMesa context could not be created (needs Mesa 11.2+ with GL 3.3 core)!" << std::endl;
+        return false;
+    }
+
+    return resize(w, h);
+}
+
+bool HeadlessContext::resize(int w, int h) {
+    if (!context || w <= 0 || h <= 0) {
+        return false;
+    }
+
+    width = w;
+    height = h;
+    pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+
+    // Binding the buffer makes it the default framebuffer of the context
+    if (!OSMesaMakeCurrent(context, pixels.data(), GL_UNSIGNED_BYTE, width, height)) {
+        std::cerr << "OSMesaMakeCurrent failed for " << width << "x" << height << " buffer!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (context) {
+        OSMesaDestroyContext(context);
+        context = nullptr;
+    }
+    pixels.clear();
+    width = 0;
+    height = 0;
+}
+
+#else
+
+HeadlessContext::HeadlessContext() : width(0), height(0) {
+}
+
+HeadlessContext::~HeadlessContext() {
+}
+
+bool HeadlessContext::isSupported() {
+    return false;
+}
+
+bool HeadlessContext::create(int, int) {
+    std::cerr << "Headless mode is not available: rebuild with -DSHADERTOY_OSMESA and link OSMesa." << std::endl;
+    return false;
+}
+
+bool HeadlessContext::resize(int, int) {
+    return false;
+}
+
+void HeadlessContext::destroy() {
+}
+
+#endif // SHADERTOY_OSMESA
+
+bool HeadlessContext::savePPM(const std::string& filePath) const {
+    if (pixels.empty()) {
+        return false;
+    }
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Could not open " << filePath << " for writing!" << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    // The buffer is stored bottom-to-top, PPM wants top-to-bottom RGB
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* src = &pixels[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return file.good();
+}
@@ -0,0 +1,165 @@
+#include "../include/headless_mode.h"
+#include "../include/headless_context.h"
+#include "../include/shader_loading.h"
+#include "../include/gpu_profiler.h"
+#include "../include/uniform_buffer.h"
+#include "../include/frame_clock.h"
+
+int runHeadless(const Options& options, const ShaderRegistry& registry, int selectedShader) {
+    HeadlessContext context;
+    if (!context.create(options.width, options.height)) {
+        return 1;
+    }
+
+    // Initialize GLEW. Without an X display GLEW reports NO_GLX_DISPLAY after
+    // loading the core entry points, which is fine for an OSMesa context.
+    glewExperimental = GL_TRUE;
+    GLenum glewError = glewInit();
+    if (glewError != GLEW_OK && glewError != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "GLEW could not be initialized! Error: " << glewGetErrorString(glewError) << std::endl;
+        return 1;
+    }
+    std::cout << "Headless renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+
+    int exitCode = 0;
+    {
+        // Scoped so programs and the quad are deleted while the context is still alive
+        ProgramBinaryCache cache(options.cacheDir);
+        initBinaryCache(options, cache);
+        ShaderManager::enableParallelCompile();
+
+        TextureCache textureCache;
+        std::vector<MultipassPipeline> pipelines(registry.getCount());
+        if (selectedShader >= 0) {
+            loadShader(pipelines, registry, selectedShader, &textureCache);
+        } else {
+            loadShaders(pipelines, registry, &textureCache);
+        }
+        if (!compileShaders(pipelines, &cache)) {
+            return 1;
+        }
+
+        GLuint quadVAO = createFullScreenQuad();
+        glViewport(0, 0, options.width, options.height);
+
+        ShaderToyGlobalsBuffer globalsBuffer;
+        globalsBuffer.init();
+
+        GpuProfiler profiler;
+        profiler.init(registry.getCount(), 8, options.frames);
+
+        const double tickMs = 1000.0 / SDL_GetPerformanceFrequency();
+        const double frameStep = 1.0 / 60.0;
+
+        // iDate is taken once so every frame of the run sees the same day
+        float startDate[4];
+        getShaderToyDate(startDate);
+
+        std::cout << "Rendering " << options.frames << " frames per shader at "
+            << options.width << "x" << options.height << std::endl;
+
+        for (int i = 0; i < registry.getCount(); i++) {
+            if (!pipelines[i].isLoaded()) {
+                continue;
+            }
+
+            double totalMs = 0.0;
+            double minMs = 1e30;
+            double maxMs = 0.0;
+
+            for (int frame = 0; frame < options.frames; frame++) {
+                Uint64 start = SDL_GetPerformanceCounter();
+
+                // Fixed timestep so every run renders the same frames
+                double time = frame * frameStep;
+                float date[4] = { startDate[0], startDate[1], startDate[2], static_cast<float>(startDate[3] + time) };
+                globalsBuffer.update(makeShaderToyGlobals(options.width, options.height,
+                    time, frameStep, frame, 0, 0, false, date));
+                profiler.begin(i);
+                pipelines[i].render(quadVAO, options.width, options.height);
+                profiler.end();
+                glFinish();
+                profiler.collect();
+
+                double ms = (SDL_GetPerformanceCounter() - start) * tickMs;
+                totalMs += ms;
+                if (ms < minMs) minMs = ms;
+                if (ms > maxMs) maxMs = ms;
+            }
+
+            std::cout << "  shader " << (i + 1) << " (" << registry.getName(i) << "): avg "
+                << totalMs / options.frames << " ms, min " << minMs << " ms, max " << maxMs << " ms";
+            if (profiler.isSupported()) {
+                std::cout << ", GPU p50 " << profiler.getStats(i).p50 << " ms";
+            }
+            std::cout << std::endl;
+
+            if (!options.outputDir.empty()) {
+                std::string imagePath = options.outputDir + "/shader" + std::to_string(i + 1) + ".ppm";
+                if (!context.savePPM(imagePath)) {
+                    exitCode = 1;
+                }
+            }
+        }
+
+        if (profiler.isSupported()) {
+            profiler.dump(registry.getNames());
+        }
+        profiler.destroy();
+        globalsBuffer.destroy();
+        glDeleteVertexArrays(1, &quadVAO);
+    }
+
+    context.destroy();
+    return exitCode;
+}
+
+int runOffscreen(const Options& options, const char* title, const std::function<int()>& body) {
+    if (options.headless) {
+        HeadlessContext context;
+        if (!context.create(16, 16)) {
+            return 1;
+        }
+        glewExperimental = GL_TRUE;
+        GLenum glewError = glewInit();
+        if (glewError != GLEW_OK && glewError != GLEW_ERROR_NO_GLX_DISPLAY) {
+            std::cerr << "GLEW could not be initialized! Error: " << glewGetErrorString(glewError) << std::endl;
+            return 1;
+        }
+        int exitCode = body();
+        context.destroy();
+        return exitCode;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_Window* window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        16, 16, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext glContext = window ? SDL_GL_CreateContext(window) : nullptr;
+
+    int exitCode = 1;
+    if (!glContext) {
+        std::cerr << "OpenGL context could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+    }
+    else {
+        glewExperimental = GL_TRUE;
+        GLenum glewError = glewInit();
+        if (glewError != GLEW_OK) {
+            std::cerr << "GLEW could not be initialized! Error: " << glewGetErrorString(glewError) << std::endl;
+        }
+        else {
+            exitCode = body();
+        }
+        SDL_GL_DeleteContext(glContext);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    SDL_Quit();
+    return exitCode;
+}
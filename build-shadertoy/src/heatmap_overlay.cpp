@@ -0,0 +1,168 @@
+#include "../include/heatmap_overlay.h"
+#include <algorithm>
+#include <iomanip>
+
+// Counts to colors: blue, cyan, green, yellow, red
+static const char* heatmapOverlayShader = R"(
+    #version 330 core
+    in vec2 fragCoord;
+    out vec4 fragColor;
+
+    uniform sampler2D counts;
+    uniform float scale;
+
+    void main() {
+        float t = clamp(texture(counts, fragCoord).r / scale, 0.0, 1.0);
+        vec3 color = clamp(1.5 - abs(4.0 * t - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+        fragColor = vec4(color, 0.6);
+    }
+)";
+
+HeatmapOverlay::HeatmapOverlay()
+    : framebuffer(0), texture(0), width(0), height(0), scaleUniform(-1), scale(64.0f) {
+}
+
+HeatmapOverlay::~HeatmapOverlay() {
+    destroy();
+}
+
+void HeatmapOverlay::init() {
+    if (!overlay.isReady() && !overlay.isCompiling()) {
+        overlay.submit(defaultVertexShader, heatmapOverlayShader);
+    }
+}
+
+bool HeatmapOverlay::poll() {
+    if (!overlay.isCompiling() || !overlay.poll()) {
+        return overlay.isReady();
+    }
+    if (overlay.hasFailed()) {
+        std::cerr << "Failed to compile the heatmap overlay!" << std::endl;
+        return false;
+    }
+    overlay.use();
+    overlay.setInt(overlay.getUniform("counts"), 0);
+    scaleUniform = overlay.getUniform("scale");
+    glUseProgram(0);
+    return true;
+}
+
+void HeatmapOverlay::destroy() {
+    if (framebuffer != 0) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+        framebuffer = 0;
+        texture = 0;
+    }
+    width = 0;
+    height = 0;
+    counts.clear();
+}
+
+GLuint HeatmapOverlay::getFramebuffer(int w, int h) {
+    if (framebuffer != 0 && w == width && h == height) {
+        return framebuffer;
+    }
+    if (framebuffer == 0) {
+        glGenFramebuffers(1, &framebuffer);
+        glGenTextures(1, &texture);
+    }
+
+    // Counts are integers, a float channel holds them exactly up to 2^24
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Heatmap target " << w << "x" << h << " is incomplete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    width = w;
+    height = h;
+    counts.clear();
+    return framebuffer;
+}
+
+void HeatmapOverlay::draw(GLuint quadVAO, int screenWidth, int screenHeight) {
+    if (framebuffer == 0 || !overlay.isReady()) {
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screenWidth, screenHeight);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    overlay.use();
+    overlay.setFloat(scaleUniform, scale);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(quadVAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+}
+
+bool HeatmapOverlay::update() {
+    if (framebuffer == 0) {
+        return false;
+    }
+    counts.resize(static_cast<size_t>(width) * height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, counts.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // The 99th percentile keeps a few extreme pixels from washing out the rest
+    std::vector<float> sorted = counts;
+    size_t rank = sorted.size() * 99 / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    scale = std::max(sorted[rank], 1.0f);
+    return true;
+}
+
+void HeatmapOverlay::printRegions(const std::string& shaderName) const {
+    if (counts.empty()) {
+        std::cout << "No heatmap read back yet" << std::endl;
+        return;
+    }
+
+    double totals[REGIONS][REGIONS] = {};
+    double total = 0.0;
+    float maximum = 0.0f;
+    for (int y = 0; y < height; y++) {
+        // Rows are stored bottom first, regions are listed top first
+        int row = (height - 1 - y) * REGIONS / height;
+        for (int x = 0; x < width; x++) {
+            float count = counts[static_cast<size_t>(y) * width + x];
+            totals[row][x * REGIONS / width] += count;
+            total += count;
+            maximum = std::max(maximum, count);
+        }
+    }
+
+    double pixels = static_cast<double>(width) * height;
+    std::cout << "Loop iterations of " << shaderName << " at " << width << "x" << height << ": " << std::fixed
+        << std::setprecision(1) << total / 1e6 << "M total, " << total / pixels << " per pixel, max " << maximum
+        << std::endl;
+    std::cout << "  Share of the total (iterations per pixel) by region, top row first:" << std::endl;
+    double regionPixels = pixels / (REGIONS * REGIONS);
+    for (int row = 0; row < REGIONS; row++) {
+        std::cout << " ";
+        for (int column = 0; column < REGIONS; column++) {
+            double share = total > 0.0 ? totals[row][column] * 100.0 / total : 0.0;
+            std::cout << std::setw(7) << share << "% (" << std::setw(6) << totals[row][column] / regionPixels << ")";
+        }
+        std::cout << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
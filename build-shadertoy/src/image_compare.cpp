@@ -0,0 +1,194 @@
+#include "../include/image_compare.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHADERTOY_SSE2
+#include <emmintrin.h>
+#endif
+
+// SSIM window edge and step, and the stabilizing constants for 8-bit data
+static const int WINDOW = 8;
+static const int WINDOW_STEP = 4;
+static const double SSIM_C1 = (0.01 * 255) * (0.01 * 255);
+static const double SSIM_C2 = (0.03 * 255) * (0.03 * 255);
+
+// Sums over one SSIM window of two luma planes
+struct WindowSums {
+    uint32_t x;
+    uint32_t y;
+    uint64_t xx;
+    uint64_t yy;
+    uint64_t xy;
+};
+
+// Sum of squared RGB differences
+static uint64_t squaredErrorScalar(const unsigned char* a, const unsigned char* b, size_t pixels) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        for (int c = 0; c < 3; c++) {
+            int difference = a[i * 4 + c] - b[i * 4 + c];
+            total += static_cast<uint64_t>(difference * difference);
+        }
+    }
+    return total;
+}
+
+static WindowSums windowSumsScalar(const unsigned char* x, const unsigned char* y, int stride) {
+    WindowSums sums = { 0, 0, 0, 0, 0 };
+    for (int row = 0; row < WINDOW; row++) {
+        for (int column = 0; column < WINDOW; column++) {
+            uint32_t a = x[row * stride + column];
+            uint32_t b = y[row * stride + column];
+            sums.x += a;
+            sums.y += b;
+            sums.xx += a * a;
+            sums.yy += b * b;
+            sums.xy += a * b;
+        }
+    }
+    return sums;
+}
+
+#ifdef SHADERTOY_SSE2
+static uint32_t horizontalSum(__m128i values) {
+    values = _mm_add_epi32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    values = _mm_add_epi32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(values));
+}
+
+// 4 pixels per step: alpha masked off, bytes widened to 16 bits, squares summed in pairs
+static uint64_t squaredErrorSse2(const unsigned char* a, const unsigned char* b, size_t pixels) {
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t total = 0;
+    size_t i = 0;
+    while (i + 4 <= pixels) {
+        // Flush the 32-bit lanes long before they can overflow
+        size_t end = std::min(pixels & ~static_cast<size_t>(3), i + 4096);
+        __m128i sum = _mm_setzero_si128();
+        for (; i < end; i += 4) {
+            __m128i pa = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4)), rgbMask);
+            __m128i pb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4)), rgbMask);
+            __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(pa, zero), _mm_unpacklo_epi8(pb, zero));
+            __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(pa, zero), _mm_unpackhi_epi8(pb, zero));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(low, low));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(high, high));
+        }
+        total += horizontalSum(sum);
+    }
+    return total + squaredErrorScalar(a + i * 4, b + i * 4, pixels - i);
+}
+
+// One 8-pixel row per step, widened to 16 bits
+static WindowSums windowSumsSse2(const unsigned char* x, const unsigned char* y, int stride) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sumX = _mm_setzero_si128();
+    __m128i sumY = _mm_setzero_si128();
+    __m128i sumXX = _mm_setzero_si128();
+    __m128i sumYY = _mm_setzero_si128();
+    __m128i sumXY = _mm_setzero_si128();
+    for (int row = 0; row < WINDOW; row++) {
+        __m128i rowX = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + row * stride));
+        __m128i rowY = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + row * stride));
+        // Byte sums against zero land in the low 64 bits
+        sumX = _mm_add_epi32(sumX, _mm_sad_epu8(rowX, zero));
+        sumY = _mm_add_epi32(sumY, _mm_sad_epu8(rowY, zero));
+        __m128i wideX = _mm_unpacklo_epi8(rowX, zero);
+        __m128i wideY = _mm_unpacklo_epi8(rowY, zero);
+        sumXX = _mm_add_epi32(sumXX, _mm_madd_epi16(wideX, wideX));
+        sumYY = _mm_add_epi32(sumYY, _mm_madd_epi16(wideY, wideY));
+        sumXY = _mm_add_epi32(sumXY, _mm_madd_epi16(wideX, wideY));
+    }
+    WindowSums sums;
+    sums.x = static_cast<uint32_t>(_mm_cvtsi128_si32(sumX));
+    sums.y = static_cast<uint32_t>(_mm_cvtsi128_si32(sumY));
+    sums.xx = horizontalSum(sumXX);
+    sums.yy = horizontalSum(sumYY);
+    sums.xy = horizontalSum(sumXY);
+    return sums;
+}
+#endif
+
+bool hasSimdImageCompare() {
+#ifdef SHADERTOY_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+// BT.601 luma in 8.8 fixed point, as the Y4M export uses
+static void lumaPlane(const unsigned char* rgba, size_t pixels, std::vector<unsigned char>& luma) {
+    luma.resize(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        luma[i] = static_cast<unsigned char>((77 * rgba[i * 4] + 150 * rgba[i * 4 + 1] + 29 * rgba[i * 4 + 2] + 128) >> 8);
+    }
+}
+
+ImageQuality compareImages(const unsigned char* image, const unsigned char* reference, int width, int height,
+    bool simd) {
+    ImageQuality quality;
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (pixels == 0) {
+        return quality;
+    }
+#ifndef SHADERTOY_SSE2
+    simd = false;
+#endif
+
+    uint64_t squaredError = 0;
+#ifdef SHADERTOY_SSE2
+    if (simd) {
+        squaredError = squaredErrorSse2(image, reference, pixels);
+    }
+    else
+#endif
+    {
+        squaredError = squaredErrorScalar(image, reference, pixels);
+    }
+    double mse = static_cast<double>(squaredError) / (pixels * 3.0);
+    quality.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+
+    // Images smaller than a window only get PSNR; SSIM then just says equal or not
+    if (width < WINDOW || height < WINDOW) {
+        quality.ssim = mse > 0.0 ? 0.0 : 1.0;
+        return quality;
+    }
+
+    std::vector<unsigned char> lumaImage;
+    std::vector<unsigned char> lumaReference;
+    lumaPlane(image, pixels, lumaImage);
+    lumaPlane(reference, pixels, lumaReference);
+
+    double total = 0.0;
+    int windows = 0;
+    const double count = WINDOW * WINDOW;
+    for (int y = 0; y + WINDOW <= height; y += WINDOW_STEP) {
+        for (int x = 0; x + WINDOW <= width; x += WINDOW_STEP) {
+            size_t offset = static_cast<size_t>(y) * width + x;
+            WindowSums sums;
+#ifdef SHADERTOY_SSE2
+            if (simd) {
+                sums = windowSumsSse2(&lumaImage[offset], &lumaReference[offset], width);
+            }
+            else
+#endif
+            {
+                sums = windowSumsScalar(&lumaImage[offset], &lumaReference[offset], width);
+            }
+
+            double meanX = sums.x / count;
+            double meanY = sums.y / count;
+            double varianceX = sums.xx / count - meanX * meanX;
+            double varianceY = sums.yy / count - meanY * meanY;
+            double covariance = sums.xy / count - meanX * meanY;
+            total += ((2.0 * meanX * meanY + SSIM_C1) * (2.0 * covariance + SSIM_C2)) /
+                ((meanX * meanX + meanY * meanY + SSIM_C1) * (varianceX + varianceY + SSIM_C2));
+            windows++;
+        }
+    }
+    quality.ssim = total / windows;
+    return quality;
+}
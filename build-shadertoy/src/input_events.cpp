@@ -0,0 +1,89 @@
+#include "../include/input_events.h"
+#include <algorithm>
+#include <cmath>
+
+// Queue a command; only mouse motion may be dropped when the render thread falls behind
+static void pushCommand(InputQueue& queue, const InputCommand& command) {
+    while (!queue.push(command)) {
+        if (command.type == InputCommand::MouseMove) {
+            return;
+        }
+        SDL_Delay(1);
+    }
+}
+
+bool pumpEvents(InputQueue& queue, int waitMs) {
+    SDL_Event e;
+    bool running = true;
+    bool haveEvent = waitMs > 0 ? SDL_WaitEventTimeout(&e, waitMs) != 0 : SDL_PollEvent(&e) != 0;
+
+    while (haveEvent) {
+        InputCommand command;
+        command.timestamp = e.common.timestamp;
+        bool send = true;
+
+        if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
+            command.type = InputCommand::Quit;
+            running = false;
+        }
+        else if (e.type == SDL_KEYDOWN) {
+            command.type = InputCommand::Key;
+            command.key = e.key.keysym.sym;
+        }
+        else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
+            command.type = InputCommand::Resize;
+            command.x = e.window.data1;
+            command.y = e.window.data2;
+        }
+        else if (e.type == SDL_MOUSEMOTION) {
+            command.type = InputCommand::MouseMove;
+            command.x = e.motion.x;
+            command.y = e.motion.y;
+        }
+        else if ((e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP) && e.button.button == SDL_BUTTON_LEFT) {
+            command.type = InputCommand::MouseButton;
+            command.x = e.button.x;
+            command.y = e.button.y;
+            command.down = (e.type == SDL_MOUSEBUTTONDOWN);
+        }
+        else {
+            send = false;
+        }
+
+        if (send) {
+            pushCommand(queue, command);
+        }
+        haveEvent = SDL_PollEvent(&e) != 0;
+    }
+    return running;
+}
+
+InputLatency::InputLatency() : samples(HISTORY_SIZE, 0.0), next(0), count(0) {
+}
+
+void InputLatency::record(Uint32 eventTimestamp) {
+    samples[next] = static_cast<double>(SDL_GetTicks() - eventTimestamp);
+    next = (next + 1) % HISTORY_SIZE;
+    if (count < HISTORY_SIZE) {
+        count++;
+    }
+}
+
+void InputLatency::print() const {
+    if (count == 0) {
+        std::cout << "Input latency: no input yet" << std::endl;
+        return;
+    }
+    std::vector<double> sorted(samples.begin(), samples.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double sample : sorted) {
+        total += sample;
+    }
+    auto percentile = [&sorted](double p) {
+        int rank = static_cast<int>(std::ceil(p * sorted.size()));
+        return sorted[std::max(rank, 1) - 1];
+    };
+    std::cout << "Input latency (event to present): mean " << total / count << " ms, p50 " << percentile(0.5)
+        << " ms, p95 " << percentile(0.95) << " ms, max " << sorted.back() << " ms over " << count << " events" << std::endl;
+}
@@ -1,63 +1,51 @@
 #include "../include/shader_manager.h"
 #include "../include/includes.h"
-
-// Function to load shader code from a file
-std::string loadShaderFromFile(const std::string& filePath) {
-    std::string shaderCode;
-    std::ifstream shaderFile;
-    // Ensure ifstream objects can throw exceptions
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        // Open file
-        shaderFile.open(filePath);
-        std::stringstream shaderStream;
-        // Read file's buffer contents into stream
-        shaderStream << shaderFile.rdbuf();
-        // Close file
-        shaderFile.close();
-        // Convert stream into string
-        shaderCode = shaderStream.str();
-    }
-    catch (std::ifstream::failure& e) {
-        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << filePath << std::endl;
-        std::cerr << "Exception: " << e.what() << std::endl;
-        return "";
-    }
-    return shaderCode;
-}
+#include "../include/options.h"
+#include "../include/program_cache.h"
+#include "../include/multipass.h"
+#include "../include/texture_cache.h"
+#include "../include/gpu_profiler.h"
+#include "../include/render_target.h"
+#include "../include/resolution_governor.h"
+#include "../include/frame_pacer.h"
+#include "../include/frame_clock.h"
+#include "../include/shader_watcher.h"
+#include "../include/input_events.h"
+#include "../include/shader_registry.h"
+#include "../include/frame_capture.h"
+#include "../include/bench_store.h"
+#include "../include/heatmap_overlay.h"
+#include "../include/shader_loading.h"
+#include "../include/headless_mode.h"
+#include "../include/export_mode.h"
+#include "../include/benchmark_mode.h"
+#include "../include/golden_mode.h"
+#include "../include/cost_mode.h"
+#include "../../SDL/SDL_image.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 // Window dimensions - now variables instead of constants
 int WINDOW_WIDTH = 1440;
 int WINDOW_HEIGHT = 720;
 
-// Number of shaders
-const int NUM_SHADERS = 11;
-
-// Shader names for console output - IMPORTANT: Make sure this matches NUM_SHADERS!
-const std::vector<std::string> SHADER_NAMES = {
-    "cubes",
-    "particles",
-    "oldschool tube",
-    "shader 4",
-    "shader 5",
-    "shader 6",
-    "shader 7",
-    "shader 8",
-    "shader 9",
-    "shader 10",
-    "shader 11"
-};
+// Shaders reachable through a key of their own (1-9 and A-Z)
+const int KEY_SLOTS = 35;
 
 // Function to get key name for display
 std::string getKeyName(int shaderIndex) {
     if (shaderIndex < 9) {
         // Use number keys 1-9 for first 9 shaders
         return std::to_string(shaderIndex + 1);
-    } else {
+    } else if (shaderIndex < KEY_SLOTS) {
         // Use letter keys A-Z for shaders 10 and beyond
         // A = shader 10, B = shader 11, etc.
         char letter = 'A' + (shaderIndex - 9);
         return std::string(1, letter);
+    } else {
+        // Past Z shaders are only reached with PageUp / PageDown or by name
+        return "#" + std::to_string(shaderIndex + 1);
     }
 }
 
@@ -72,14 +60,165 @@ void handleResize(int width, int height) {
     std::cout << "Window resized to: " << width << "x" << height << std::endl;
 }
 
-int main(int argc, char* argv[]) {
-    // Validate shader configuration
-    if (SHADER_NAMES.size() != NUM_SHADERS) {
-        std::cerr << "ERROR: Number of shader names (" << SHADER_NAMES.size()
-            << ") doesn't match NUM_SHADERS (" << NUM_SHADERS << ")" << std::endl;
-        return 1;
+// Compile order of the window: the shader shown first, then the others cheapest first
+// by estimated cost, so the most shaders become selectable soonest (short loops and
+// sources also compile faster). Shaders of unknown cost (0) go last.
+std::vector<int> getCompileOrder(const std::vector<float>& costs, int firstShader) {
+    std::vector<int> order;
+    for (int id = 0; id < static_cast<int>(costs.size()); id++) {
+        if (id != firstShader) {
+            order.push_back(id);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&costs](int a, int b) {
+        return costs[a] > 0.0f && (costs[b] <= 0.0f || costs[a] < costs[b]);
+    });
+    order.insert(order.begin(), firstShader);
+    return order;
+}
+
+// Lazy mode: load a shader's files on first selection, then compile it. Returns true
+// when its files were loaded just now (so they are not watched yet).
+bool loadAndSubmitShader(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, int index,
+    TextureCache* textureCache, ProgramBinaryCache* cache) {
+    bool wasLoaded = pipelines[index].isLoaded();
+    loadShader(pipelines, registry, index, textureCache);
+    submitShader(pipelines, index, cache);
+    return !wasLoaded;
+}
+
+// Lazy mode: predict the next selection (the shaders on the neighbouring keys) and
+// compile one of them ahead of time. Only runs once the active shader is on screen
+// and nothing else is compiling, so it never competes with the shader being viewed.
+// Returns true when a shader's files were loaded for it.
+bool precompileNeighbours(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, int activeShader,
+    TextureCache* textureCache, ProgramBinaryCache* cache) {
+    if (!pipelines[activeShader].isReady()) {
+        return false;
+    }
+    int shaderCount = static_cast<int>(pipelines.size());
+    for (int i = 0; i < shaderCount; i++) {
+        if (pipelines[i].isCompiling()) {
+            return false;
+        }
     }
 
+    const int offsets[] = { 1, -1 };
+    for (int offset : offsets) {
+        int candidate = (activeShader + offset + shaderCount) % shaderCount;
+        if (!pipelines[candidate].isSubmitted()) {
+            std::cout << "Precompiling shader " << getKeyName(candidate) << " in the background" << std::endl;
+            return loadAndSubmitShader(pipelines, registry, candidate, textureCache, cache);
+        }
+    }
+    return false;
+}
+
+// Check on shaders that are still compiling and return how many are left. Without
+// parallel compile support polling blocks, so only one shader (the active one first)
+// is finished per call to keep frames coming.
+int pollShaders(std::vector<MultipassPipeline>& pipelines, int activeShader) {
+    bool blocking = !ShaderManager::hasParallelCompile() && !ShaderManager::hasCompileWorker();
+    bool finishedOne = false;
+    int remaining = 0;
+
+    int shaderCount = static_cast<int>(pipelines.size());
+    for (int n = 0; n < shaderCount; n++) {
+        int i = (activeShader + n) % shaderCount;
+        if (!pipelines[i].isCompiling()) {
+            continue;
+        }
+        if ((blocking && finishedOne) || !pipelines[i].poll()) {
+            remaining++;
+            continue;
+        }
+        finishedOne = true;
+        if (pipelines[i].hasFailed()) {
+            std::cerr << "Failed to load shader " << (i+1) << "!" << std::endl;
+        }
+    }
+    return remaining;
+}
+
+// Every source file (image and buffer passes) the pipelines are built from, once each
+std::vector<std::string> collectSourcePaths(const std::vector<MultipassPipeline>& pipelines) {
+    std::vector<std::string> paths;
+    for (const MultipassPipeline& pipeline : pipelines) {
+        for (const std::string& path : pipeline.getSourcePaths()) {
+            if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+                paths.push_back(path);
+            }
+        }
+    }
+    return paths;
+}
+
+// Hot reload: hand edited sources to every pipeline that uses the file. Changed passes
+// recompile in the background while their old program keeps rendering. A change to
+// the #iChannel layout builds a replacement pipeline instead: the watcher thread reads
+// its files, startRebuilds() loads it and finishRebuilds() swaps it in once all of its
+// passes have linked.
+void applyShaderChanges(ShaderWatcher& watcher, std::vector<MultipassPipeline>& pipelines, ProgramBinaryCache* cache) {
+    for (const ShaderChange& change : watcher.takeChanges()) {
+        for (int i = 0; i < static_cast<int>(pipelines.size()); i++) {
+            MultipassPipeline::ReloadResult result = pipelines[i].reload(change.path, change.code, cache);
+            if (result == MultipassPipeline::NotUsed) {
+                continue;
+            }
+            std::cout << "Reloading shader " << getKeyName(i) << " (" << change.path << ")" << std::endl;
+            if (result == MultipassPipeline::NeedsRebuild) {
+                watcher.requestSources(pipelines[i].getImagePath());
+            }
+        }
+    }
+}
+
+// Load replacement pipelines from the files the watcher thread has read for them
+void startRebuilds(ShaderWatcher& watcher, std::vector<MultipassPipeline>& pipelines,
+    std::vector<std::unique_ptr<MultipassPipeline>>& rebuilds, TextureCache* textureCache, ProgramBinaryCache* cache) {
+    for (const PipelineSources& sources : watcher.takeSources()) {
+        for (int i = 0; i < static_cast<int>(pipelines.size()); i++) {
+            if (pipelines[i].getImagePath() != sources.imagePath) {
+                continue;
+            }
+            std::unique_ptr<MultipassPipeline> rebuild(new MultipassPipeline());
+            if (!rebuild->load(sources, textureCache, pipelines[i].getDefines())) {
+                std::cerr << "Reload of shader " << getKeyName(i) << " failed, keeping the running version" << std::endl;
+                continue;
+            }
+            if (pipelines[i].isSubmitted()) {
+                rebuild->submit(cache);
+            }
+            rebuilds[i] = std::move(rebuild);
+        }
+    }
+}
+
+// Swap in replacement pipelines whose passes have all finished. Returns true when a
+// pipeline was replaced (its set of source files may have changed).
+bool finishRebuilds(std::vector<MultipassPipeline>& pipelines, std::vector<std::unique_ptr<MultipassPipeline>>& rebuilds) {
+    bool replaced = false;
+    for (int i = 0; i < static_cast<int>(pipelines.size()); i++) {
+        if (!rebuilds[i] || (rebuilds[i]->isSubmitted() && !rebuilds[i]->poll())) {
+            continue;
+        }
+        if (rebuilds[i]->hasFailed()) {
+            std::cerr << "Reload of shader " << getKeyName(i) << " failed, keeping the running version" << std::endl;
+        }
+        else {
+            pipelines[i].swap(*rebuilds[i]);
+            replaced = true;
+        }
+        rebuilds[i].reset();
+    }
+    return replaced;
+}
+
+// Interactive renderer: SDL window, keyboard shader switching
+int runWindowed(const Options& options, const ShaderRegistry& registry, int selectedShader) {
+    // Startup metrics are measured from here
+    Uint64 startupCounter = SDL_GetPerformanceCounter();
+
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -126,42 +265,97 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // getCost() reads the shader files, so once per shader at startup (lazy mode avoids
+    // it); the key list and the compile order share the result
+    std::vector<float> costs(registry.getCount(), 0.0f);
+    if (!options.lazy) {
+        for (int i = 0; i < registry.getCount(); i++) {
+            costs[i] = registry.getCost(i);
+        }
+    }
+
     // Print key mapping information
     std::cout << "Shader Key Mappings:" << std::endl;
-    for (int i = 0; i < NUM_SHADERS; i++) {
-        std::cout << "  " << getKeyName(i) << " -> " << SHADER_NAMES[i] << std::endl;
-    }
-
-    // Load shader code from files
-    std::vector<std::string> shaderCodes;
-    for (int i = 1; i <= NUM_SHADERS; i++) {
-        std::string shaderPath = "../shaders/shader" + std::to_string(i) + ".glsl";
-        std::cout << "Loading shader from: " << shaderPath << std::endl;
-        std::string code = loadShaderFromFile(shaderPath);
-        if (code.empty()) {
-            std::cerr << "Failed to load shader" << i << ".glsl!" << std::endl;
-            SDL_GL_DeleteContext(glContext);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            return 1;
+    for (int i = 0; i < registry.getCount() && i < KEY_SLOTS; i++) {
+        std::cout << "  " << getKeyName(i) << " -> " << registry.getName(i);
+        if (costs[i] > 0.0f) {
+            std::cout << " (cost " << costs[i] << ")";
         }
-        shaderCodes.push_back(code);
+        std::cout << std::endl;
+    }
+    if (registry.getCount() > KEY_SLOTS) {
+        std::cout << "  ... " << (registry.getCount() - KEY_SLOTS) << " more, use --shader NAME" << std::endl;
     }
+    std::cout << "  PageUp / PageDown -> previous / next shader" << std::endl;
+    std::cout << "  F1 -> dump GPU profile" << std::endl;
+    std::cout << "  F2 -> cycle vsync / adaptive vsync / free running" << std::endl;
+    std::cout << "  F3 -> print frame pacing, input latency and capture statistics" << std::endl;
+    std::cout << "  F4 -> pause / resume time, F5 -> step one frame while paused" << std::endl;
+    std::cout << "  F6 / F7 -> halve / double time speed, F8 -> real-time speed" << std::endl;
+    std::cout << "  F9 -> screenshot, F10 -> start / stop recording" << std::endl;
+    std::cout << "  F11 -> loop iteration heatmap, F12 -> print its per-region totals" << std::endl;
 
-    // Create shader managers and compile shaders
-    std::vector<ShaderManager> shaderManagers(NUM_SHADERS);
-    for (int i = 0; i < NUM_SHADERS; i++) {
-        std::cout << "Compiling shader " << (i+1) << "..." << std::endl;
-        std::string fragmentShaderSource = createShaderToyFragmentShader(shaderCodes[i]);
-        if (!shaderManagers[i].loadFromStrings(defaultVertexShader, fragmentShaderSource)) {
-            std::cerr << "Failed to load shader " << (i+1) << "!" << std::endl;
-            SDL_GL_DeleteContext(glContext);
-            SDL_DestroyWindow(window);
-            SDL_Quit();
-            return 1;
-        }
+    // Active shader (0-based index)
+    int activeShader = selectedShader >= 0 ? selectedShader : 0;
+
+    // Load shader code from files; lazy mode reads a shader's files on first selection,
+    // so startup does not grow with the size of the registry
+    TextureCache textureCache;
+    std::vector<MultipassPipeline> pipelines(registry.getCount());
+    if (options.lazy) {
+        loadShader(pipelines, registry, activeShader, &textureCache);
+    } else {
+        loadShaders(pipelines, registry, &textureCache);
+    }
+
+    // Create shader managers and submit all shaders at once. Their status is polled
+    // from the main loop so the window shows frames while the driver compiles.
+    ProgramBinaryCache cache(options.cacheDir);
+    initBinaryCache(options, cache);
+
+    // Compiles run on a worker thread with a shared context when possible, so even
+    // long ones never stall input or rendering; otherwise ask the driver for threads
+    CompileWorker compileWorker;
+    if (options.compileThread && compileWorker.start(window, glContext)) {
+        ShaderManager::setCompileWorker(&compileWorker);
+        std::cout << "Background compile thread enabled" << std::endl;
+    }
+    else if (ShaderManager::enableParallelCompile()) {
+        std::cout << "Parallel shader compile enabled" << std::endl;
+    }
+
+    // Cheap program shown while the selected shader is still compiling
+    ShaderManager placeholder;
+    if (!placeholder.loadFromStrings(defaultVertexShader, createShaderToyFragmentShader(placeholderShaderCode))) {
+        std::cerr << "Failed to compile the placeholder shader!" << std::endl;
+    }
+
+    // Loop iteration heatmap (F11): counts from an instrumented copy of the image pass
+    HeatmapOverlay heatmap;
+    bool heatmapOn = options.heatmap;
+    if (heatmapOn) {
+        heatmap.init();
+    }
+    bool heatmapReport = false;
+
+    // Lazy mode only compiles the first shader now, the rest on selection
+    if (options.lazy) {
+        std::cout << "Lazy compilation: shaders compile on first selection" << std::endl;
+        submitShader(pipelines, activeShader, &cache);
+    } else {
+        submitShaders(pipelines, &cache, getCompileOrder(costs, activeShader));
+    }
+    bool allShadersReady = false;
+    bool firstFrameShown = false;
+
+    // Watch the shader files and recompile edits without restarting
+    ShaderWatcher watcher;
+    std::vector<std::unique_ptr<MultipassPipeline>> rebuilds(registry.getCount());
+    if (options.watch) {
+        std::vector<std::string> paths = collectSourcePaths(pipelines);
+        watcher.start(paths);
+        std::cout << "Watching " << paths.size() << " shader files for changes" << std::endl;
     }
-    std::cout << "All " << NUM_SHADERS << " shaders compiled successfully!" << std::endl;
 
     // Create full-screen quad
     GLuint quadVAO = createFullScreenQuad();
@@ -169,113 +363,437 @@ int main(int argc, char* argv[]) {
     // Initialize viewport
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    // Main loop flag
-    bool quit = false;
-    SDL_Event e;
+    // ShaderToy globals shared by every program
+    ShaderToyGlobalsBuffer globalsBuffer;
+    if (!globalsBuffer.init()) {
+        std::cerr << "Failed to create the ShaderToy globals buffer!" << std::endl;
+    }
+
+    // Per-shader GPU timing, also what the dynamic resolution governor reacts to
+    GpuProfiler profiler;
+    profiler.init(registry.getCount());
+
+    // Dynamic resolution: render offscreen at a scale picked from GPU frame time
+    RenderTarget sceneTarget;
+    ResolutionGovernor governor;
+    governor.configure(options.frameBudgetMs, options.minScale, 1.0f);
+    if (options.dynamicResolution) {
+        // Expensive shaders start small instead of missing the budget until the governor catches up
+        governor.reset(governor.getStartScale(registry.getCost(activeShader), WINDOW_WIDTH, WINDOW_HEIGHT));
+        std::cout << "Dynamic resolution: " << options.frameBudgetMs << " ms GPU budget, scale "
+            << options.minScale << "-1.0, starting at " << governor.getScale() << std::endl;
+    }
+
+    // Swap interval and frame limiter. Without working vsync or an explicit rate,
+    // limit to 60 fps rather than spinning the GPU flat out.
+    FramePacer pacer;
+    bool swapApplied = pacer.setSwapMode(options.swapMode);
+    double targetFps = options.targetFps;
+    if (targetFps == 0.0 && !swapApplied && options.swapMode != SwapMode::FreeRunning) {
+        targetFps = 60.0;
+    }
+    pacer.setTargetRate(targetFps);
+    std::cout << "Frame pacing: " << getSwapModeName(pacer.getSwapMode());
+    if (targetFps > 0.0) {
+        std::cout << ", limited to " << targetFps << " fps";
+    }
+    std::cout << std::endl;
+
+    // Screenshots and recordings, read back asynchronously and encoded off-thread
+    FrameCapture capture;
+    capture.setDirectory(options.captureDir);
+    if (options.record) {
+        capture.startRecording(targetFps > 0.0 ? targetFps : 60.0);
+    }
 
     // For timing
-    Uint32 currentTime = SDL_GetTicks();
-    Uint32 lastTime = currentTime;
-    float deltaTime = 0.0f;
+    FrameClock clock;
+    clock.configure(options.timeWrap, options.timePeriod);
+    clock.setScale(options.timeScale);
     int frame = 0;
 
     // Mouse position
     int mouseX = 0, mouseY = 0;
     bool mouseDown = false;
 
-    // Active shader (0-based index)
-    int activeShader = 0;
-    std::cout << "Starting with shader 1 (" << SHADER_NAMES[activeShader] << ")" << std::endl;
-
-    // Main loop
-    while (!quit) {
-        // Handle events
-        while (SDL_PollEvent(&e) != 0) {
-            if (e.type == SDL_QUIT) {
-                quit = true;
+    std::cout << "Starting with shader " << getKeyName(activeShader) << " (" << registry.getName(activeShader) << ")" << std::endl;
+    std::vector<std::string> shaderNames = registry.getNames();
+
+    // Input reaches the render loop as commands through a lock-free queue, filled by
+    // the event thread (or by the render loop itself with --single-thread)
+    InputQueue inputQueue;
+    InputLatency inputLatency;
+
+    auto renderLoop = [&]() {
+        bool quit = false;
+        while (!quit) {
+            // Single-threaded: pump events here at the start of the frame (a queued
+            // quit is handled below like any other command)
+            if (!options.renderThread) {
+                pumpEvents(inputQueue, 0);
             }
-            else if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_ESCAPE) {
+
+            // Apply input. The oldest event of the frame is timed until its present.
+            InputCommand command;
+            bool haveInput = false;
+            Uint32 oldestInput = 0;
+            while (inputQueue.pop(command)) {
+                if (command.type != InputCommand::Resize && !haveInput) {
+                    haveInput = true;
+                    oldestInput = command.timestamp;
+                }
+
+                if (command.type == InputCommand::Quit) {
                     quit = true;
                 }
-                // Handle shader switching with number keys (1-9)
-                else if (e.key.keysym.sym >= SDLK_1 && e.key.keysym.sym <= SDLK_9) {
-                    int newShader = e.key.keysym.sym - SDLK_1;
-                    if (newShader < NUM_SHADERS) {
-                        activeShader = newShader;
-                        std::cout << "Switched to shader " << getKeyName(activeShader)
-                            << " (" << SHADER_NAMES[activeShader] << ")" << std::endl;
+                else if (command.type == InputCommand::Resize) {
+                    handleResize(command.x, command.y);
+                }
+                else if (command.type == InputCommand::MouseMove) {
+                    mouseX = command.x;
+                    mouseY = command.y;
+                }
+                else if (command.type == InputCommand::MouseButton) {
+                    mouseDown = command.down;
+                    mouseX = command.x;
+                    mouseY = command.y;
+                }
+                else if (command.key == SDLK_F1) {
+                    profiler.dump(shaderNames);
+                }
+                else if (command.key == SDLK_F2) {
+                    SwapMode nextMode = SwapMode::VSync;
+                    if (pacer.getSwapMode() == SwapMode::VSync) {
+                        nextMode = SwapMode::AdaptiveVSync;
                     }
+                    else if (pacer.getSwapMode() == SwapMode::AdaptiveVSync) {
+                        nextMode = SwapMode::FreeRunning;
+                    }
+                    pacer.setSwapMode(nextMode);
+                    std::cout << "Swap mode: " << getSwapModeName(pacer.getSwapMode()) << std::endl;
+                }
+                else if (command.key == SDLK_F3) {
+                    pacer.printStats();
+                    inputLatency.print();
+                    capture.printStats();
+                }
+                else if (command.key == SDLK_F4) {
+                    clock.setPaused(!clock.isPaused());
+                    std::cout << (clock.isPaused() ? "Paused" : "Resumed") << " at " << clock.getShaderTime() << " s" << std::endl;
+                }
+                else if (command.key == SDLK_F5) {
+                    clock.step(1.0 / 60.0);
+                }
+                else if (command.key == SDLK_F11) {
+                    heatmapOn = !heatmapOn;
+                    if (heatmapOn) {
+                        heatmap.init();
+                    }
+                    std::cout << "Loop iteration heatmap " << (heatmapOn ? "on" : "off") << std::endl;
                 }
-                // Handle shader switching with letter keys (A-Z for shaders 10-35)
-                else if (e.key.keysym.sym >= SDLK_a && e.key.keysym.sym <= SDLK_z) {
-                    int newShader = (e.key.keysym.sym - SDLK_a) + 9; // A = shader 10, B = shader 11, etc.
-                    if (newShader < NUM_SHADERS) {
+                else if (command.key == SDLK_F12) {
+                    if (heatmapOn) {
+                        heatmapReport = true;
+                    }
+                    else {
+                        std::cout << "The heatmap is off, F11 turns it on" << std::endl;
+                    }
+                }
+                else if (command.key == SDLK_F9) {
+                    capture.requestScreenshot();
+                }
+                else if (command.key == SDLK_F10) {
+                    if (capture.isRecording()) {
+                        capture.stopRecording();
+                    }
+                    else {
+                        capture.startRecording(targetFps > 0.0 ? targetFps : 60.0);
+                    }
+                }
+                else if (command.key == SDLK_F6 || command.key == SDLK_F7 || command.key == SDLK_F8) {
+                    double scale = 1.0;
+                    if (command.key == SDLK_F6) {
+                        scale = clock.getScale() * 0.5;
+                    }
+                    else if (command.key == SDLK_F7) {
+                        scale = clock.getScale() * 2.0;
+                    }
+                    clock.setScale(scale);
+                    std::cout << "Time speed x" << clock.getScale() << std::endl;
+                }
+                // Handle shader switching with number keys (1-9), letter keys
+                // (A-Z for shaders 10-35) and PageUp / PageDown through all of them
+                else {
+                    int shaderCount = registry.getCount();
+                    int newShader = -1;
+                    if (command.key >= SDLK_1 && command.key <= SDLK_9) {
+                        newShader = command.key - SDLK_1;
+                    }
+                    else if (command.key >= SDLK_a && command.key <= SDLK_z) {
+                        newShader = (command.key - SDLK_a) + 9; // A = shader 10, B = shader 11, etc.
+                    }
+                    else if (command.key == SDLK_PAGEDOWN) {
+                        newShader = (activeShader + 1) % shaderCount;
+                    }
+                    else if (command.key == SDLK_PAGEUP) {
+                        newShader = (activeShader + shaderCount - 1) % shaderCount;
+                    }
+                    if (newShader >= 0 && newShader < shaderCount) {
+                        // getCost() reads the shader files, so only when the scale uses it
+                        if (options.dynamicResolution) {
+                            governor.calibrate(registry.getCost(activeShader), WINDOW_WIDTH, WINDOW_HEIGHT);
+                        }
                         activeShader = newShader;
                         std::cout << "Switched to shader " << getKeyName(activeShader)
-                            << " (" << SHADER_NAMES[activeShader] << ")" << std::endl;
+                            << " (" << registry.getName(activeShader) << ")" << std::endl;
+                        if (!pipelines[activeShader].isSubmitted() &&
+                            loadAndSubmitShader(pipelines, registry, activeShader, &textureCache, &cache) && options.watch) {
+                            watcher.addPaths(pipelines[activeShader].getSourcePaths());
+                        }
+                        if (options.dynamicResolution) {
+                            governor.reset(governor.getStartScale(registry.getCost(activeShader), WINDOW_WIDTH,
+                                WINDOW_HEIGHT));
+                        }
                     }
                 }
             }
-            else if (e.type == SDL_WINDOWEVENT) {
-                if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    // Handle window resize
-                    handleResize(e.window.data1, e.window.data2);
+            if (quit) {
+                break;
+            }
+
+            // Start recompiling edited files and swap in rebuilt pipelines that are done
+            if (options.watch) {
+                applyShaderChanges(watcher, pipelines, &cache);
+                startRebuilds(watcher, pipelines, rebuilds, &textureCache, &cache);
+                if (finishRebuilds(pipelines, rebuilds)) {
+                    watcher.addPaths(collectSourcePaths(pipelines));
                 }
             }
-            else if (e.type == SDL_MOUSEMOTION) {
-                SDL_GetMouseState(&mouseX, &mouseY);
+
+            // Pick up shaders that finished compiling (also reloads after startup)
+            int compiling = pollShaders(pipelines, activeShader);
+            if (!options.lazy && !allShadersReady && compiling == 0) {
+                allShadersReady = true;
+                int failedCount = 0;
+                for (int i = 0; i < registry.getCount(); i++) {
+                    if (pipelines[i].hasFailed()) {
+                        failedCount++;
+                    }
+                }
+                std::cout << "Time to all shaders ready: " << millisecondsSince(startupCounter) << " ms ("
+                    << (registry.getCount() - failedCount) << " ok, " << failedCount << " failed";
+                if (cache.isEnabled()) {
+                    std::cout << ", " << cache.getHits() << " from binary cache";
+                }
+                std::cout << ")" << std::endl;
             }
-            else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    mouseDown = true;
-                    SDL_GetMouseState(&mouseX, &mouseY);
+
+            // Advance the clock. A rebase restarts the animation from frame zero.
+            double deltaTime = clock.tick();
+            if (clock.consumeRebase()) {
+                frame = 0;
+                for (auto& pipeline : pipelines) {
+                    pipeline.resetBuffers();
                 }
             }
-            else if (e.type == SDL_MOUSEBUTTONUP) {
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    mouseDown = false;
+            float date[4];
+            getShaderToyDate(date);
+
+            // Internal render size; iResolution and the mouse are reported in it
+            int renderWidth = WINDOW_WIDTH;
+            int renderHeight = WINDOW_HEIGHT;
+            if (options.dynamicResolution) {
+                governor.getRenderSize(WINDOW_WIDTH, WINDOW_HEIGHT, renderWidth, renderHeight);
+            }
+
+            // Upload this frame's globals once for every pass
+            globalsBuffer.update(makeShaderToyGlobals(
+                renderWidth, renderHeight, clock.getShaderTime(), deltaTime, frame,
+                mouseX * renderWidth / WINDOW_WIDTH, mouseY * renderHeight / WINDOW_HEIGHT, mouseDown, date
+            ));
+
+            // Render the active shader with its buffer passes. A shader that is still
+            // compiling (or failed) is replaced by the placeholder.
+            if (pipelines[activeShader].isReady()) {
+                profiler.begin(activeShader);
+                if (options.dynamicResolution) {
+                    sceneTarget.resize(renderWidth, renderHeight);
+                    pipelines[activeShader].render(quadVAO, renderWidth, renderHeight, sceneTarget.getFramebuffer());
+                    sceneTarget.blitToScreen(WINDOW_WIDTH, WINDOW_HEIGHT);
+                } else {
+                    pipelines[activeShader].render(quadVAO, WINDOW_WIDTH, WINDOW_HEIGHT);
                 }
+                profiler.end();
+
+                // Heatmap over the frame, outside the profiled span. The instrumented
+                // program is built on first use and again after edits of the image pass;
+                // both it and the overlay compile in the background like the shaders, and
+                // nothing is drawn until they are ready.
+                MultipassPipeline& pipeline = pipelines[activeShader];
+                if (heatmapOn) {
+                    if (!heatmap.poll() && heatmap.hasFailed()) {
+                        heatmapOn = false;
+                    }
+                    int loops = 0;
+                    if (pipeline.canBuildHeatmap() && pipeline.submitHeatmap(&loops)) {
+                        std::cout << "Heatmap of " << registry.getName(activeShader) << ": " << loops
+                            << " for loops instrumented, compiling" << std::endl;
+                    }
+                    pipeline.pollHeatmap();
+                }
+                if (heatmapOn && heatmap.isReady() && pipeline.hasHeatmap()) {
+                    pipeline.renderHeatmap(quadVAO, renderWidth, renderHeight,
+                        heatmap.getFramebuffer(renderWidth, renderHeight));
+                    // Reading back stalls, so the color scale only follows every 30 frames
+                    if (frame % 30 == 0 || heatmapReport) {
+                        heatmap.update();
+                    }
+                    if (heatmapReport) {
+                        heatmap.printRegions(registry.getName(activeShader));
+                        heatmapReport = false;
+                    }
+                    heatmap.draw(quadVAO, WINDOW_WIDTH, WINDOW_HEIGHT);
+                }
+            } else {
+                glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+                renderShaderToyFrame(placeholder, quadVAO);
             }
-        }
 
-        // Calculate time
-        lastTime = currentTime;
-        currentTime = SDL_GetTicks();
-        deltaTime = (currentTime - lastTime) / 1000.0f;
-        float time = currentTime / 1000.0f;
-
-        // Clear the screen
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Use the active shader and set uniforms
-        if (activeShader >= 0 && activeShader < NUM_SHADERS) {
-            shaderManagers[activeShader].use();
-            shaderManagers[activeShader].setupShaderToyUniforms(
-                WINDOW_WIDTH, WINDOW_HEIGHT, time, deltaTime, frame, mouseX, mouseY, mouseDown
-            );
-        }
+            // Feed GPU times that have arrived (a few frames late) to the governor
+            int gpuTag = 0;
+            double gpuMs = 0.0;
+            while (profiler.fetch(gpuTag, gpuMs)) {
+                if (options.dynamicResolution && gpuTag == activeShader && governor.update(gpuMs)) {
+                    std::cout << "Render scale " << governor.getScale() << " (GPU "
+                        << governor.getSmoothedMs() << " ms)" << std::endl;
+                }
+            }
 
-        // Draw the quad
-        glBindVertexArray(quadVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+            // Read back the finished frame if a capture wants it (does not wait on the GPU)
+            capture.capture(WINDOW_WIDTH, WINDOW_HEIGHT, frame);
 
-        // Swap buffers
-        SDL_GL_SwapWindow(window);
+            // Swap buffers
+            SDL_GL_SwapWindow(window);
+            if (haveInput) {
+                inputLatency.record(oldestInput);
+            }
 
-        // Increment frame counter
-        frame++;
+            if (!firstFrameShown) {
+                firstFrameShown = true;
+                std::cout << "Time to first frame: " << millisecondsSince(startupCounter) << " ms" << std::endl;
+            }
+
+            // Increment frame counter (held while paused, except for single steps)
+            if (!clock.isPaused() || deltaTime > 0.0) {
+                frame++;
+            }
+
+            // Use the idle part of the frame to compile what is likely selected next
+            if (options.lazy && precompileNeighbours(pipelines, registry, activeShader, &textureCache, &cache) &&
+                options.watch) {
+                watcher.addPaths(collectSourcePaths(pipelines));
+            }
 
-        // Add a small delay to reduce CPU usage
-        SDL_Delay(16); // ~60 FPS
+            // Wait for the next frame deadline (no-op without a limiter)
+            pacer.wait();
+        }
+    };
+
+    if (options.renderThread) {
+        // The context moves to the render thread; this thread only pumps SDL events,
+        // which SDL requires on the thread that created the window
+        SDL_GL_MakeCurrent(window, nullptr);
+        std::atomic<bool> rendering(true);
+        std::thread renderThread([&]() {
+            SDL_GL_MakeCurrent(window, glContext);
+            renderLoop();
+            SDL_GL_MakeCurrent(window, nullptr);
+            rendering = false;
+        });
+        while (rendering && pumpEvents(inputQueue, 10)) {
+        }
+        renderThread.join();
+        SDL_GL_MakeCurrent(window, glContext);
+    }
+    else {
+        renderLoop();
     }
 
     // Clean up
+    watcher.stop();
+    rebuilds.clear();
+    ShaderManager::setCompileWorker(nullptr);
+    compileWorker.stop();
+    profiler.collect();
+    profiler.dump(shaderNames);
+    profiler.destroy();
+    pacer.printStats();
+    inputLatency.print();
+    capture.shutdown();
+    capture.printStats();
+    heatmap.destroy();
+    sceneTarget.destroy();
+    globalsBuffer.destroy();
+    textureCache.destroy();
     glDeleteVertexArrays(1, &quadVAO);
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;
-}
\ No newline at end of file
+}
+
+// Run the mode the options select
+int runMode(const Options& options, const ShaderRegistry& registry, int selectedShader) {
+    if (options.costReport) {
+        return runCostReport(registry, selectedShader);
+    }
+    if (!options.compareBase.empty()) {
+        return compareBenchRuns(options.benchStore, options.compareBase, options.compareCandidate);
+    }
+    if (!options.goldenDir.empty()) {
+        return runGolden(options, registry, selectedShader);
+    }
+    if (!options.benchScript.empty()) {
+        return runBenchmark(options, registry);
+    }
+    if (!options.exportPath.empty()) {
+        return runExport(options, registry, selectedShader);
+    }
+    if (options.headless) {
+        return runHeadless(options, registry, selectedShader);
+    }
+    return runWindowed(options, registry, selectedShader);
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    WINDOW_WIDTH = options.width;
+    WINDOW_HEIGHT = options.height;
+
+    // The shader set, indexed in the cache directory so later starts skip the scan
+    ShaderRegistry registry;
+    if (!registry.open(options.shaderSource, options.cacheDir + "/shader_index.bin")) {
+        return 1;
+    }
+    int selectedShader = -1;
+    if (!options.shader.empty()) {
+        selectedShader = registry.find(options.shader);
+        if (selectedShader < 0) {
+            std::cerr << "Unknown shader: " << options.shader << std::endl;
+            return 1;
+        }
+    }
+
+    // Image files (iChannel textures, golden references, PNG export) are decoded from
+    // several places, so SDL_image is set up once for the whole run
+    int imageFlags = IMG_INIT_PNG | IMG_INIT_JPG;
+    if ((IMG_Init(imageFlags) & imageFlags) == 0) {
+        std::cerr << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError() << std::endl;
+    }
+    int exitCode = runMode(options, registry, selectedShader);
+    IMG_Quit();
+    return exitCode;
+}
@@ -0,0 +1,543 @@
+#include "../include/multipass.h"
+#include <functional>
+
+// Limit on how deep buffer passes may reference further buffers
+static const int MAX_BUFFER_DEPTH = 4;
+
+// ShaderToy offers at most Buffer A-D
+static const int MAX_BUFFERS = 4;
+
+MultipassPipeline::MultipassPipeline()
+    : heatmapFailed(false), textureCache(nullptr), preloaded(nullptr), loadFailed(false), bufferWidth(0), bufferHeight(0), submitted(false) {
+}
+
+MultipassPipeline::~MultipassPipeline() {
+    releaseBuffers();
+}
+
+bool MultipassPipeline::load(const std::string& code, const std::string& imagePath, TextureCache* textures,
+    const std::string& defineBlock) {
+    releaseBuffers();
+    buffers.clear();
+    submitted = false;
+    textureCache = textures;
+    images.clear();
+    defines = defineBlock;
+    loadFailed = true;
+
+    ShaderToySource source = parseShaderToySource(code, imagePath);
+    imageCode = source.code;
+    std::string selfPath = normalizeShaderPath(imagePath);
+    this->imagePath = selfPath;
+    if (code.empty()) {
+        return false;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        imageChannels[i] = source.channels[i];
+        if (imageChannels[i].type != ChannelInput::Buffer) {
+            continue;
+        }
+        if (imageChannels[i].path == selfPath) {
+            std::cerr << imagePath << ": the image pass cannot read itself, iChannel" << i << " ignored" << std::endl;
+            imageChannels[i] = ChannelInput();
+            continue;
+        }
+        if (!loadBuffer(imageChannels[i].path, 1)) {
+            return false;
+        }
+    }
+
+    sortBuffers();
+    if (!buffers.empty()) {
+        std::cout << "  " << imagePath << ": " << buffers.size() << " buffer pass(es)" << std::endl;
+    }
+    loadFailed = false;
+    return true;
+}
+
+bool MultipassPipeline::load(const PipelineSources& sources, TextureCache* textures, const std::string& defineBlock) {
+    auto image = sources.files.find(sources.imagePath);
+    preloaded = &sources;
+    bool loaded = load(image != sources.files.end() ? image->second : "", sources.imagePath, textures, defineBlock);
+    preloaded = nullptr;
+    if (loaded) {
+        images = sources.images;
+    }
+    return loaded;
+}
+
+void readPipelineSources(const std::string& imagePath, PipelineSources& sources) {
+    sources.imagePath = normalizeShaderPath(imagePath);
+    sources.files.clear();
+    sources.images.clear();
+
+    // Follow buffer references breadth first, as deep as load() would go
+    std::vector<std::string> level(1, sources.imagePath);
+    for (int depth = 0; depth <= MAX_BUFFER_DEPTH && !level.empty(); depth++) {
+        std::vector<std::string> next;
+        for (const std::string& path : level) {
+            if (sources.files.count(path)) {
+                continue;
+            }
+            std::string code = loadShaderFromFile(path);
+            sources.files[path] = code;
+            if (code.empty()) {
+                continue;
+            }
+            ShaderToySource source = parseShaderToySource(code, path);
+            for (const ChannelInput& input : source.channels) {
+                if (input.type == ChannelInput::Buffer) {
+                    next.push_back(input.path);
+                }
+                else if (input.type == ChannelInput::Texture && !sources.images.count(input.path)) {
+                    DecodedImage& decoded = sources.images[input.path];
+                    if (!decodeImage(input.path, decoded)) {
+                        decoded = DecodedImage();
+                    }
+                }
+            }
+        }
+        level.swap(next);
+    }
+}
+
+int MultipassPipeline::findBuffer(const std::string& path) const {
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (buffers[i]->path == path) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool MultipassPipeline::loadBuffer(const std::string& path, int depth) {
+    if (findBuffer(path) >= 0) {
+        return true;
+    }
+    if (depth > MAX_BUFFER_DEPTH || static_cast<int>(buffers.size()) >= MAX_BUFFERS) {
+        std::cerr << "Too many buffer passes, cannot add " << path << std::endl;
+        return false;
+    }
+
+    std::string code;
+    if (preloaded) {
+        auto file = preloaded->files.find(path);
+        if (file != preloaded->files.end()) {
+            code = file->second;
+        }
+    }
+    else {
+        code = loadShaderFromFile(path);
+    }
+    if (code.empty()) {
+        std::cerr << "Failed to load buffer pass " << path << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<BufferPass> pass(new BufferPass());
+    ShaderToySource source = parseShaderToySource(code, path);
+    pass->path = path;
+    pass->code = source.code;
+    for (int i = 0; i < 4; i++) {
+        pass->channels[i] = source.channels[i];
+    }
+    buffers.push_back(std::move(pass));
+
+    // Load whatever this buffer reads in turn
+    const ChannelInput* channels = buffers.back()->channels;
+    for (int i = 0; i < 4; i++) {
+        if (channels[i].type == ChannelInput::Buffer && !loadBuffer(channels[i].path, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MultipassPipeline::sortBuffers() {
+    // Resolve the dependency graph to indices before anything is moved
+    std::vector<std::vector<int>> dependencies(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        for (const ChannelInput& input : buffers[i]->channels) {
+            if (input.type == ChannelInput::Buffer) {
+                dependencies[i].push_back(findBuffer(input.path));
+            }
+        }
+    }
+
+    // Depth-first topological sort: a pass runs after the passes it reads. An edge
+    // back to a pass that is still being visited is a cycle; the reader then simply
+    // sees that pass's previous frame.
+    std::vector<int> order;
+    std::vector<int> state(buffers.size(), 0); // 0 = new, 1 = visiting, 2 = done
+    std::function<void(int)> visit = [&](int index) {
+        if (index < 0 || state[index] != 0) {
+            return;
+        }
+        state[index] = 1;
+        for (int dependency : dependencies[index]) {
+            visit(dependency);
+        }
+        state[index] = 2;
+        order.push_back(index);
+    };
+    for (const ChannelInput& input : imageChannels) {
+        if (input.type == ChannelInput::Buffer) {
+            visit(findBuffer(input.path));
+        }
+    }
+
+    std::vector<std::unique_ptr<BufferPass>> ordered;
+    for (int index : order) {
+        ordered.push_back(std::move(buffers[index]));
+    }
+    buffers.swap(ordered);
+}
+
+void MultipassPipeline::resolveTextures(ChannelInput* channels) {
+    for (int i = 0; i < 4; i++) {
+        if (channels[i].type != ChannelInput::Texture || channels[i].texture != 0 || !textureCache) {
+            continue;
+        }
+        auto image = images.find(channels[i].path);
+        CachedTexture cached = textureCache->acquire(channels[i].path, image != images.end() ? &image->second : nullptr);
+        channels[i].texture = cached.texture;
+        channels[i].width = cached.width;
+        channels[i].height = cached.height;
+    }
+}
+
+std::string MultipassPipeline::fragmentSource(const std::string& code) const {
+    return createShaderToyFragmentShader(defines + code);
+}
+
+void MultipassPipeline::submit(ProgramBinaryCache* cache) {
+    // Nothing to compile, the pipeline simply stays failed
+    if (loadFailed) {
+        submitted = true;
+        return;
+    }
+
+    resolveTextures(imageChannels);
+    for (auto& pass : buffers) {
+        resolveTextures(pass->channels);
+    }
+    images.clear();
+
+    for (auto& pass : buffers) {
+        pass->shader.submit(defaultVertexShader, fragmentSource(pass->code), cache);
+    }
+    imageShader.submit(defaultVertexShader, fragmentSource(imageCode), cache);
+    submitted = true;
+}
+
+// Same inputs in every slot (resolved texture handles are not compared)
+static bool sameChannels(const ChannelInput* a, const ChannelInput* b) {
+    for (int i = 0; i < 4; i++) {
+        if (a[i].type != b[i].type || a[i].path != b[i].path) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MultipassPipeline::ReloadResult MultipassPipeline::reload(const std::string& path, const std::string& code,
+    ProgramBinaryCache* cache) {
+    std::string normalized = normalizeShaderPath(path);
+    if (loadFailed) {
+        // Fixing any of its files loads the whole pipeline again
+        return (normalized == imagePath || findBuffer(normalized) >= 0) ? NeedsRebuild : NotUsed;
+    }
+    ShaderToySource source = parseShaderToySource(code, path);
+
+    ChannelInput* channels = nullptr;
+    ShaderManager* shader = nullptr;
+    std::string* passCode = nullptr;
+    if (normalized == imagePath) {
+        // The image pass drops a self reference at load time, so compare the same way
+        for (ChannelInput& input : source.channels) {
+            if (input.type == ChannelInput::Buffer && input.path == imagePath) {
+                input = ChannelInput();
+            }
+        }
+        channels = imageChannels;
+        shader = &imageShader;
+        passCode = &imageCode;
+    }
+    else {
+        int index = findBuffer(normalized);
+        if (index < 0) {
+            return NotUsed;
+        }
+        channels = buffers[index]->channels;
+        shader = &buffers[index]->shader;
+        passCode = &buffers[index]->code;
+    }
+
+    if (!sameChannels(channels, source.channels)) {
+        return NeedsRebuild;
+    }
+
+    *passCode = source.code;
+    if (shader == &imageShader) {
+        // The heatmap variant is stale now; it is built again when next needed
+        ShaderManager stale;
+        heatmapShader.swap(stale);
+        heatmapFailed = false;
+    }
+    if (submitted) {
+        shader->submit(defaultVertexShader, fragmentSource(*passCode), cache);
+    }
+    return Recompiling;
+}
+
+std::vector<std::string> MultipassPipeline::getSourcePaths() const {
+    std::vector<std::string> paths;
+    if (!isLoaded()) {
+        return paths;
+    }
+    paths.push_back(imagePath);
+    for (const auto& pass : buffers) {
+        paths.push_back(pass->path);
+    }
+    return paths;
+}
+
+void MultipassPipeline::swap(MultipassPipeline& other) {
+    imagePath.swap(other.imagePath);
+    imageCode.swap(other.imageCode);
+    for (int i = 0; i < 4; i++) {
+        std::swap(imageChannels[i], other.imageChannels[i]);
+    }
+    imageShader.swap(other.imageShader);
+    heatmapShader.swap(other.heatmapShader);
+    std::swap(heatmapFailed, other.heatmapFailed);
+    std::swap(textureCache, other.textureCache);
+    images.swap(other.images);
+    defines.swap(other.defines);
+    std::swap(loadFailed, other.loadFailed);
+    buffers.swap(other.buffers);
+    std::swap(bufferWidth, other.bufferWidth);
+    std::swap(bufferHeight, other.bufferHeight);
+    std::swap(submitted, other.submitted);
+}
+
+bool MultipassPipeline::poll(bool wait) {
+    bool finished = true;
+    for (auto& pass : buffers) {
+        finished = pass->shader.poll(wait) && finished;
+    }
+    return imageShader.poll(wait) && finished;
+}
+
+bool MultipassPipeline::isReady() const {
+    for (const auto& pass : buffers) {
+        if (!pass->shader.isReady()) {
+            return false;
+        }
+    }
+    return imageShader.isReady();
+}
+
+bool MultipassPipeline::isCompiling() const {
+    for (const auto& pass : buffers) {
+        if (pass->shader.isCompiling()) {
+            return true;
+        }
+    }
+    return imageShader.isCompiling();
+}
+
+bool MultipassPipeline::hasFailed() const {
+    for (const auto& pass : buffers) {
+        if (pass->shader.hasFailed()) {
+            return true;
+        }
+    }
+    return loadFailed || imageShader.hasFailed();
+}
+
+void MultipassPipeline::allocateBuffers(int width, int height) {
+    releaseBuffers();
+
+    for (auto& pass : buffers) {
+        glGenTextures(2, pass->textures);
+        glGenFramebuffers(2, pass->framebuffers);
+        for (int i = 0; i < 2; i++) {
+            // ShaderToy buffers are 32-bit float RGBA
+            glBindTexture(GL_TEXTURE_2D, pass->textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffers[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass->textures[i], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Framebuffer for " << pass->path << " is incomplete!" << std::endl;
+            }
+        }
+        pass->current = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    bufferWidth = width;
+    bufferHeight = height;
+    resetBuffers();
+}
+
+void MultipassPipeline::releaseBuffers() {
+    for (auto& pass : buffers) {
+        if (pass->framebuffers[0] != 0) {
+            glDeleteFramebuffers(2, pass->framebuffers);
+            glDeleteTextures(2, pass->textures);
+            pass->framebuffers[0] = pass->framebuffers[1] = 0;
+            pass->textures[0] = pass->textures[1] = 0;
+        }
+    }
+    bufferWidth = 0;
+    bufferHeight = 0;
+}
+
+void MultipassPipeline::resetBuffers() {
+    const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (auto& pass : buffers) {
+        for (int i = 0; i < 2; i++) {
+            if (pass->framebuffers[i] != 0) {
+                glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffers[i]);
+                glClearBufferfv(GL_COLOR, 0, zero);
+            }
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void MultipassPipeline::bindChannels(const ChannelInput* channels, ShaderManager& shader) {
+    float resolutions[4 * 3] = {};
+    for (int i = 0; i < 4; i++) {
+        GLuint texture = 0;
+        if (channels[i].type == ChannelInput::Buffer) {
+            int index = findBuffer(channels[i].path);
+            if (index >= 0) {
+                texture = buffers[index]->textures[buffers[index]->current];
+                resolutions[i * 3 + 0] = static_cast<float>(bufferWidth);
+                resolutions[i * 3 + 1] = static_cast<float>(bufferHeight);
+            }
+        }
+        else if (channels[i].type == ChannelInput::Texture) {
+            texture = channels[i].texture;
+            resolutions[i * 3 + 0] = static_cast<float>(channels[i].width);
+            resolutions[i * 3 + 1] = static_cast<float>(channels[i].height);
+        }
+        resolutions[i * 3 + 2] = 1.0f;
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    // Only programs that actually read iChannelResolution get an upload
+    shader.setVec3Array(shader.getChannelResolutionUniform(), resolutions, 4);
+}
+
+void MultipassPipeline::render(GLuint quadVAO, int width, int height, GLuint targetFramebuffer) {
+    if (!buffers.empty() && (width != bufferWidth || height != bufferHeight)) {
+        allocateBuffers(width, height);
+    }
+
+    glBindVertexArray(quadVAO);
+
+    for (auto& pass : buffers) {
+        // Write the other texture of the pair; channels bound now still see the old one
+        int target = 1 - pass->current;
+        glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffers[target]);
+        glViewport(0, 0, width, height);
+        pass->shader.use();
+        bindChannels(pass->channels, pass->shader);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        pass->current = target;
+    }
+
+    // Image pass
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    imageShader.use();
+    bindChannels(imageChannels, imageShader);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    glBindVertexArray(0);
+}
+
+void MultipassPipeline::prepareTiles(int width, int height) {
+    if (!buffers.empty() && (width != bufferWidth || height != bufferHeight)) {
+        allocateBuffers(width, height);
+    }
+}
+
+void MultipassPipeline::drawTile(int pass, GLuint quadVAO, int x, int y, int tileWidth, int tileHeight,
+    GLuint imageFramebuffer) {
+    glBindVertexArray(quadVAO);
+
+    if (pass < static_cast<int>(buffers.size())) {
+        // The viewport offset moves gl_FragCoord along with the tile
+        BufferPass& buffer = *buffers[pass];
+        glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffers[1 - buffer.current]);
+        glViewport(x, y, tileWidth, tileHeight);
+        buffer.shader.use();
+        bindChannels(buffer.channels, buffer.shader);
+    }
+    else {
+        // The image target only holds one tile; the wrapper adds the offset instead
+        glBindFramebuffer(GL_FRAMEBUFFER, imageFramebuffer);
+        glViewport(0, 0, tileWidth, tileHeight);
+        imageShader.use();
+        bindChannels(imageChannels, imageShader);
+        imageShader.setVec2(imageShader.getFragCoordOffsetUniform(), static_cast<float>(x), static_cast<float>(y));
+    }
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    glBindVertexArray(0);
+}
+
+void MultipassPipeline::endPass(int pass) {
+    if (pass < static_cast<int>(buffers.size())) {
+        // Only now do readers see this frame's output
+        buffers[pass]->current = 1 - buffers[pass]->current;
+    }
+    else {
+        // render() relies on the default offset of zero
+        imageShader.use();
+        imageShader.setVec2(imageShader.getFragCoordOffsetUniform(), 0.0f, 0.0f);
+    }
+}
+
+bool MultipassPipeline::submitHeatmap(int* loops) {
+    if (!isReady()) {
+        return false;
+    }
+    // Built once per edit of the image pass, the binary cache is not worth it here
+    heatmapShader.submit(defaultVertexShader, createHeatmapFragmentShader(defines + imageCode, loops));
+    return true;
+}
+
+void MultipassPipeline::pollHeatmap() {
+    if (heatmapShader.isCompiling() && heatmapShader.poll()) {
+        heatmapFailed = heatmapShader.hasFailed();
+    }
+}
+
+void MultipassPipeline::renderHeatmap(GLuint quadVAO, int width, int height, GLuint framebuffer) {
+    if (!heatmapShader.isReady()) {
+        return;
+    }
+    glBindVertexArray(quadVAO);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+    heatmapShader.use();
+    bindChannels(imageChannels, heatmapShader);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
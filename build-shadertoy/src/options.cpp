@@ -0,0 +1,275 @@
+#include "../include/options.h"
+
+// Parse "WIDTHxHEIGHT"
+static bool parseSize(const std::string& text, int& width, int& height) {
+    size_t x = text.find('x');
+    if (x == std::string::npos) {
+        return false;
+    }
+    try {
+        width = std::stoi(text.substr(0, x));
+        height = std::stoi(text.substr(x + 1));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return width > 0 && height > 0;
+}
+
+static bool parseInt(const std::string& text, int& value) {
+    try {
+        size_t used = 0;
+        value = std::stoi(text, &used);
+        return used == text.size();
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+static bool parseDouble(const std::string& text, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used == text.size();
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]" << std::endl
+        << "  --headless           Render offscreen through OSMesa (no window, no swap)" << std::endl
+        << "  --size WxH           Window / offscreen size (default 1440x720)" << std::endl
+        << "  --frames N           Headless: frames rendered per shader; export: frames written (default 60)" << std::endl
+        << "  --shaders PATH       Shader directory or manifest file (default ../shaders)" << std::endl
+        << "  --shader N|NAME      Start with this shader; headless: only render it" << std::endl
+        << "  --out DIR            Headless: save the last frame of each shader as DIR/shaderN.ppm" << std::endl
+        << "  --export PATH        Render --frames frames at a fixed 1/--fps timestep to PATH.y4m or a" << std::endl
+        << "                       directory of PNG / raw RGBA frames (with --headless on servers)" << std::endl
+        << "  --export-format F    y4m, png or rgba (default from PATH, png for a directory)" << std::endl
+        << "  --start-frame N      Export: first frame to write (default 0)" << std::endl
+        << "  --export-threads N   Export: encoder threads (default: cores - 1)" << std::endl
+        << "  --tile N             Export: render in tiles of about N pixels, sized to --tile-budget" << std::endl
+        << "                       (used automatically when --size exceeds the GPU's limits)" << std::endl
+        << "  --tile-budget MS     Export: GPU time one tile may take (default 100)" << std::endl
+        << "  --bench SCRIPT       Run the benchmark scenarios in SCRIPT (with --headless in CI)" << std::endl
+        << "  --bench-out PATH     Benchmark results, .csv or .json (default benchmark.json)" << std::endl
+        << "  --bench-store PATH   Append raw benchmark samples to PATH (default ../bench/results.tsv, \"\" = off)" << std::endl
+        << "  --bench-run NAME     Name of the run in the store (default: its start time)" << std::endl
+        << "  --compare BASE NEW   Test two runs of the store for frame time regressions (Mann-Whitney U);" << std::endl
+        << "                       run names or last / previous, exits 1 on a regression" << std::endl
+        << "  --golden DIR         Render every shader (or --shader) with fixed inputs and compare with the" << std::endl
+        << "                       reference PNGs in DIR (PSNR / SSIM), exits 1 on a difference" << std::endl
+        << "  --golden-update      Write the reference images instead of comparing" << std::endl
+        << "  --golden-sizes LIST  Sizes to render, e.g. 320x180,1280x720 (default 320x180,640x360)" << std::endl
+        << "  --golden-psnr DB     Lowest PSNR that passes (default 40)" << std::endl
+        << "  --capture-dir DIR    Where F9 screenshots and F10 recordings go (default ../captures)" << std::endl
+        << "  --record             Record the window to a Y4M file from the first frame (F10 stops)" << std::endl
+        << "  --heatmap            Start with the per-pixel loop iteration heatmap (F11 toggles, F12 totals)" << std::endl
+        << "  --cost               Print the estimated operations per pixel of every shader (or --shader)" << std::endl
+        << "                       from its source, without rendering" << std::endl
+        << "  --lazy               Compile shaders on first selection, precompile neighbours when idle" << std::endl
+        << "  --dynres             Dynamic resolution: scale the internal size to meet the frame budget" << std::endl
+        << "  --frame-budget MS    GPU time per frame the dynamic resolution aims for (default 16.6)" << std::endl
+        << "  --min-scale F        Lowest dynamic resolution scale (default 0.25)" << std::endl
+        << "  --swap MODE          vsync, adaptive (late frames tear) or off (default vsync)" << std::endl
+        << "  --fps N              Limit the frame rate with a sleep+spin limiter, 0 = off (default 0)" << std::endl
+        << "                       Export: frames per second of the output (default 60)" << std::endl
+        << "  --time-wrap S        Run iTime modulo S seconds (keeps float precision on long uptimes)" << std::endl
+        << "  --time-rebase S      Restart iTime, iFrame and buffers every S seconds" << std::endl
+        << "  --time-scale F       Time speed multiplier (default 1)" << std::endl
+        << "  --single-thread      Handle events and render on one thread (compare input latency)" << std::endl
+        << "  --no-compile-thread  Compile on the render thread instead of a shared-context worker" << std::endl
+        << "  --no-watch           Do not reload shader files when they change on disk" << std::endl
+        << "  --no-cache           Always compile GLSL, skip the program binary cache" << std::endl
+        << "  --cache-dir DIR      Program binary cache directory (default ../cache)" << std::endl
+        << "  --help               Show this message" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--size" && hasValue) {
+            if (!parseSize(argv[++i], options.width, options.height)) {
+                std::cerr << "Invalid --size, expected WIDTHxHEIGHT" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--frames" && hasValue) {
+            if (!parseInt(argv[++i], options.frames) || options.frames <= 0) {
+                std::cerr << "Invalid --frames, expected a positive number" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--shaders" && hasValue) {
+            options.shaderSource = argv[++i];
+        }
+        else if (arg == "--shader" && hasValue) {
+            // Resolved against the shader registry once it is open
+            options.shader = argv[++i];
+        }
+        else if (arg == "--out" && hasValue) {
+            options.outputDir = argv[++i];
+        }
+        else if (arg == "--export" && hasValue) {
+            options.exportPath = argv[++i];
+        }
+        else if (arg == "--export-format" && hasValue) {
+            options.exportFormat = argv[++i];
+        }
+        else if (arg == "--start-frame" && hasValue) {
+            if (!parseInt(argv[++i], options.startFrame) || options.startFrame < 0) {
+                std::cerr << "Invalid --start-frame, expected a frame number" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--export-threads" && hasValue) {
+            if (!parseInt(argv[++i], options.exportThreads) || options.exportThreads <= 0) {
+                std::cerr << "Invalid --export-threads, expected a positive number" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--tile" && hasValue) {
+            if (!parseInt(argv[++i], options.tileSize) || options.tileSize <= 0) {
+                std::cerr << "Invalid --tile, expected a tile size in pixels" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--tile-budget" && hasValue) {
+            if (!parseDouble(argv[++i], options.tileBudgetMs) || options.tileBudgetMs <= 0.0) {
+                std::cerr << "Invalid --tile-budget, expected milliseconds" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--bench" && hasValue) {
+            options.benchScript = argv[++i];
+        }
+        else if (arg == "--bench-out" && hasValue) {
+            options.benchOutput = argv[++i];
+        }
+        else if (arg == "--bench-store" && hasValue) {
+            options.benchStore = argv[++i];
+        }
+        else if (arg == "--bench-run" && hasValue) {
+            options.benchRun = argv[++i];
+        }
+        else if (arg == "--compare" && i + 2 < argc) {
+            options.compareBase = argv[++i];
+            options.compareCandidate = argv[++i];
+        }
+        else if (arg == "--golden" && hasValue) {
+            options.goldenDir = argv[++i];
+        }
+        else if (arg == "--golden-update") {
+            options.goldenUpdate = true;
+        }
+        else if (arg == "--golden-sizes" && hasValue) {
+            options.goldenSizes = argv[++i];
+        }
+        else if (arg == "--golden-psnr" && hasValue) {
+            if (!parseDouble(argv[++i], options.goldenMinPsnr)) {
+                std::cerr << "Invalid --golden-psnr, expected decibels" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--capture-dir" && hasValue) {
+            options.captureDir = argv[++i];
+        }
+        else if (arg == "--record") {
+            options.record = true;
+        }
+        else if (arg == "--heatmap") {
+            options.heatmap = true;
+        }
+        else if (arg == "--cost") {
+            options.costReport = true;
+        }
+        else if (arg == "--lazy") {
+            options.lazy = true;
+        }
+        else if (arg == "--dynres") {
+            options.dynamicResolution = true;
+        }
+        else if (arg == "--frame-budget" && hasValue) {
+            if (!parseDouble(argv[++i], options.frameBudgetMs) || options.frameBudgetMs <= 0.0) {
+                std::cerr << "Invalid --frame-budget, expected milliseconds" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--min-scale" && hasValue) {
+            double scale = 0.0;
+            if (!parseDouble(argv[++i], scale) || scale <= 0.0 || scale > 1.0) {
+                std::cerr << "Invalid --min-scale, expected a value in (0, 1]" << std::endl;
+                return false;
+            }
+            options.minScale = static_cast<float>(scale);
+        }
+        else if (arg == "--swap" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "vsync") {
+                options.swapMode = SwapMode::VSync;
+            }
+            else if (mode == "adaptive") {
+                options.swapMode = SwapMode::AdaptiveVSync;
+            }
+            else if (mode == "off") {
+                options.swapMode = SwapMode::FreeRunning;
+            }
+            else {
+                std::cerr << "Invalid --swap, expected vsync, adaptive or off" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--fps" && hasValue) {
+            if (!parseDouble(argv[++i], options.targetFps) || options.targetFps < 0.0) {
+                std::cerr << "Invalid --fps, expected a non-negative rate" << std::endl;
+                return false;
+            }
+        }
+        else if ((arg == "--time-wrap" || arg == "--time-rebase") && hasValue) {
+            if (!parseDouble(argv[++i], options.timePeriod) || options.timePeriod <= 0.0) {
+                std::cerr << "Invalid " << arg << ", expected seconds" << std::endl;
+                return false;
+            }
+            options.timeWrap = (arg == "--time-wrap") ? TimeWrap::Wrap : TimeWrap::Rebase;
+        }
+        else if (arg == "--time-scale" && hasValue) {
+            if (!parseDouble(argv[++i], options.timeScale) || options.timeScale < 0.0) {
+                std::cerr << "Invalid --time-scale, expected a non-negative factor" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--single-thread") {
+            options.renderThread = false;
+        }
+        else if (arg == "--no-compile-thread") {
+            options.compileThread = false;
+        }
+        else if (arg == "--no-watch") {
+            options.watch = false;
+        }
+        else if (arg == "--no-cache") {
+            options.useBinaryCache = false;
+        }
+        else if (arg == "--cache-dir" && hasValue) {
+            options.cacheDir = argv[++i];
+        }
+        else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return false;
+        }
+        else {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+#include "../include/program_cache.h"
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+
+// Layout of an entry file: header followed by the raw driver binary
+struct CacheEntryHeader {
+    char magic[4];          // "STPB"
+    uint32_t version;       // Bumped whenever the layout changes
+    uint64_t key;           // Must match the key the file name was derived from
+    uint32_t binaryFormat;  // Format returned by glGetProgramBinary
+    uint32_t binarySize;
+    uint64_t checksum;      // Hash of the binary, catches truncated/corrupt files
+};
+
+static const uint32_t CACHE_VERSION = 1;
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : directory(directory), enabled(false), hits(0), misses(0) {
+}
+
+bool ProgramBinaryCache::init() {
+    enabled = false;
+
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        std::cout << "Program binary cache disabled: GL_ARB_get_program_binary not supported" << std::endl;
+        return false;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0) {
+        std::cout << "Program binary cache disabled: driver exposes no binary formats" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Program binary cache disabled: cannot create " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    // Binaries are only valid for the exact driver that produced them
+    driverString = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "|" +
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|" +
+        reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    enabled = true;
+    std::cout << "Program binary cache: " << directory << std::endl;
+    return true;
+}
+
+uint64_t ProgramBinaryCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+    const char separator = '\0';
+    uint64_t key = hashBytes(driverString.data(), driverString.size());
+    key = hashBytes(&separator, 1, key);
+    key = hashBytes(vertexSource.data(), vertexSource.size(), key);
+    key = hashBytes(&separator, 1, key);
+    key = hashBytes(fragmentSource.data(), fragmentSource.size(), key);
+    return key;
+}
+
+std::string ProgramBinaryCache::entryPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+GLuint ProgramBinaryCache::load(const std::string& vertexSource, const std::string& fragmentSource) {
+    if (!enabled) {
+        return 0;
+    }
+
+    uint64_t key = makeKey(vertexSource, fragmentSource);
+    std::string path = entryPath(key);
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        misses++;
+        return 0;
+    }
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    // The binary must fill the rest of the file exactly; a damaged size is never allocated
+    CacheEntryHeader header;
+    std::vector<char> binary;
+    bool valid = false;
+    if (fileSize >= static_cast<std::streamoff>(sizeof(header)) &&
+        file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        memcmp(header.magic, "STPB", 4) == 0 &&
+        header.version == CACHE_VERSION &&
+        header.key == key &&
+        static_cast<std::streamoff>(header.binarySize) == fileSize - static_cast<std::streamoff>(sizeof(header))) {
+        binary.resize(header.binarySize);
+        valid = file.read(binary.data(), binary.size()) &&
+            hashBytes(binary.data(), binary.size()) == header.checksum;
+    }
+    file.close();
+
+    if (!valid) {
+        // A read-only cache directory keeps the entry; it is simply ignored again next time
+        std::cerr << "Discarding invalid program cache entry " << path << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        misses++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    // The driver may reject a binary even if it produced it (e.g. after an update that
+    // kept the version string), in that case fall back to a full compile
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        std::cerr << "Driver rejected cached program binary " << path << ", recompiling" << std::endl;
+        glDeleteProgram(program);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        misses++;
+        return 0;
+    }
+
+    hits++;
+    return program;
+}
+
+void ProgramBinaryCache::store(GLuint program, const std::string& vertexSource, const std::string& fragmentSource) {
+    if (!enabled || program == 0) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    binary.resize(written);
+
+    CacheEntryHeader header;
+    memcpy(header.magic, "STPB", 4);
+    header.version = CACHE_VERSION;
+    header.key = makeKey(vertexSource, fragmentSource);
+    header.binaryFormat = format;
+    header.binarySize = static_cast<uint32_t>(binary.size());
+    header.checksum = hashBytes(binary.data(), binary.size());
+
+    // Write to a temporary file first so a crash never leaves a half-written entry
+    std::string path = entryPath(header.key);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Could not write program cache entry " << tempPath << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+    }
+}
@@ -0,0 +1,96 @@
+#include "../include/resolution_governor.h"
+#include <algorithm>
+#include <cmath>
+
+// Smoothing factor of the exponential moving average of GPU time
+static const double SMOOTHING = 0.1;
+
+// Scale up only when below this fraction of the budget
+static const double HEADROOM = 0.75;
+
+// Frames to wait after a change so the average reflects the new resolution
+static const int COOLDOWN_FRAMES = 30;
+
+// Scales are rounded to this step, which limits how often targets get reallocated
+static const float SCALE_STEP = 0.05f;
+
+// GPU ms per unit of estimated cost and megapixel assumed before calibrate() measured
+// it. Estimates count loops to their limits, so real shaders mostly come in cheaper.
+static const double DEFAULT_MS_PER_COST = 0.5;
+
+ResolutionGovernor::ResolutionGovernor()
+    : budgetMs(16.6), minScale(0.25f), maxScale(1.0f), scale(1.0f), smoothedMs(0.0), samples(0), cooldown(0),
+      msPerCost(0.0) {
+}
+
+void ResolutionGovernor::configure(double budget, float minimum, float maximum) {
+    budgetMs = budget;
+    minScale = minimum;
+    maxScale = maximum;
+    reset(std::min(scale, maxScale));
+}
+
+void ResolutionGovernor::reset(float newScale) {
+    scale = std::max(minScale, std::min(maxScale, newScale));
+    smoothedMs = 0.0;
+    samples = 0;
+    cooldown = COOLDOWN_FRAMES;
+}
+
+float ResolutionGovernor::getStartScale(float cost, int outputWidth, int outputHeight) const {
+    double megapixels = static_cast<double>(outputWidth) * outputHeight / 1e6;
+    if (cost <= 0.0f || megapixels <= 0.0) {
+        return scale;
+    }
+    // Same target as update(): the middle of the hysteresis band, time growing with scale^2
+    double fullMs = (msPerCost > 0.0 ? msPerCost : DEFAULT_MS_PER_COST) * cost * megapixels;
+    double target = budgetMs * (1.0 + HEADROOM) * 0.5;
+    float wanted = static_cast<float>(std::sqrt(target / fullMs));
+    wanted = std::floor(wanted / SCALE_STEP) * SCALE_STEP;
+    return std::max(minScale, std::min(maxScale, wanted));
+}
+
+void ResolutionGovernor::calibrate(float cost, int outputWidth, int outputHeight) {
+    double megapixels = static_cast<double>(outputWidth) * outputHeight * scale * scale / 1e6;
+    if (cost <= 0.0f || megapixels <= 0.0 || samples < COOLDOWN_FRAMES) {
+        return;
+    }
+    msPerCost = smoothedMs / (cost * megapixels);
+}
+
+bool ResolutionGovernor::update(double gpuMs) {
+    smoothedMs = (samples == 0) ? gpuMs : smoothedMs + SMOOTHING * (gpuMs - smoothedMs);
+    samples++;
+
+    if (cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    bool overBudget = smoothedMs > budgetMs;
+    bool headroom = smoothedMs < budgetMs * HEADROOM;
+    if (!overBudget && !headroom) {
+        return false;
+    }
+
+    // GPU time of a fragment-bound shader grows with the pixel count, i.e. scale^2,
+    // so aim for the scale that would land in the middle of the hysteresis band
+    double target = budgetMs * (1.0 + HEADROOM) * 0.5;
+    float wanted = scale * static_cast<float>(std::sqrt(target / std::max(smoothedMs, 0.01)));
+    wanted = std::round(wanted / SCALE_STEP) * SCALE_STEP;
+    wanted = std::max(minScale, std::min(maxScale, wanted));
+
+    // Only move in the direction the thresholds asked for
+    if ((overBudget && wanted >= scale) || (headroom && wanted <= scale)) {
+        return false;
+    }
+
+    scale = wanted;
+    cooldown = COOLDOWN_FRAMES;
+    return true;
+}
+
+void ResolutionGovernor::getRenderSize(int outputWidth, int outputHeight, int& renderWidth, int& renderHeight) const {
+    renderWidth = std::max(1, static_cast<int>(outputWidth * scale + 0.5f));
+    renderHeight = std::max(1, static_cast<int>(outputHeight * scale + 0.5f));
+}
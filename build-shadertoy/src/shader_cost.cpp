@@ -0,0 +1,967 @@
+#include "../include/shader_cost.h"
+#include "../include/shader_manager.h"
+#include "../include/program_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+
+// Weight of the three kinds of work in the score, in ALU operations
+static const double TRANSCENDENTAL_WEIGHT = 4.0;
+static const double TEXTURE_WEIGHT = 8.0;
+
+// Trip count assumed for loops whose bounds cannot be worked out
+static const double GUESSED_TRIPS = 16.0;
+
+// Larger trip counts are taken for a misread bound
+static const double MAX_TRIPS = 100000.0;
+
+// Macros may refer to each other, up to this deep
+static const int MAX_EXPANSION_DEPTH = 8;
+
+float ShaderCost::getScore() const {
+    return static_cast<float>((alu + transcendental * TRANSCENDENTAL_WEIGHT + texture * TEXTURE_WEIGHT) / 1000.0);
+}
+
+ShaderCost& ShaderCost::operator+=(const ShaderCost& other) {
+    alu += other.alu;
+    transcendental += other.transcendental;
+    texture += other.texture;
+    loops += other.loops;
+    guessedLoops += other.guessedLoops;
+    return *this;
+}
+
+// The operations of a cost repeated n times; loops are counted where they appear, once
+static ShaderCost repeated(const ShaderCost& cost, double n) {
+    ShaderCost result = cost;
+    result.alu *= n;
+    result.transcendental *= n;
+    result.texture *= n;
+    return result;
+}
+
+// The operations of the dearer of two branches, the loops of both
+static ShaderCost dearer(const ShaderCost& a, const ShaderCost& b) {
+    ShaderCost result = a.getScore() >= b.getScore() ? a : b;
+    result.loops = a.loops + b.loops;
+    result.guessedLoops = a.guessedLoops + b.guessedLoops;
+    return result;
+}
+
+// Cost of the built-in functions, in GLSL operations whatever the vector size
+struct BuiltinCost {
+    const char* name;
+    double alu;
+    double transcendental;
+    double texture;
+};
+
+static const BuiltinCost builtinCosts[] = {
+    { "sin", 0, 1, 0 }, { "cos", 0, 1, 0 }, { "tan", 0, 1, 0 },
+    { "asin", 0, 1, 0 }, { "acos", 0, 1, 0 }, { "atan", 0, 1, 0 },
+    { "sinh", 0, 1, 0 }, { "cosh", 0, 1, 0 }, { "tanh", 0, 1, 0 },
+    { "asinh", 0, 1, 0 }, { "acosh", 0, 1, 0 }, { "atanh", 0, 1, 0 },
+    { "exp", 0, 1, 0 }, { "exp2", 0, 1, 0 }, { "log", 0, 1, 0 }, { "log2", 0, 1, 0 },
+    { "sqrt", 0, 1, 0 }, { "inversesqrt", 0, 1, 0 }, { "pow", 1, 2, 0 },
+    { "length", 2, 1, 0 }, { "distance", 3, 1, 0 }, { "normalize", 3, 1, 0 }, { "refract", 8, 1, 0 },
+    { "abs", 1, 0, 0 }, { "sign", 1, 0, 0 }, { "floor", 1, 0, 0 }, { "ceil", 1, 0, 0 },
+    { "round", 1, 0, 0 }, { "trunc", 1, 0, 0 }, { "fract", 1, 0, 0 }, { "mod", 2, 0, 0 },
+    { "min", 1, 0, 0 }, { "max", 1, 0, 0 }, { "clamp", 2, 0, 0 }, { "step", 1, 0, 0 },
+    { "mix", 3, 0, 0 }, { "smoothstep", 6, 0, 0 }, { "dot", 2, 0, 0 }, { "cross", 3, 0, 0 },
+    { "reflect", 3, 0, 0 }, { "faceforward", 2, 0, 0 }, { "radians", 1, 0, 0 }, { "degrees", 1, 0, 0 },
+    { "inverse", 20, 0, 0 }, { "determinant", 5, 0, 0 }, { "transpose", 0, 0, 0 }, { "matrixCompMult", 1, 0, 0 },
+    { "dFdx", 1, 0, 0 }, { "dFdy", 1, 0, 0 }, { "fwidth", 2, 0, 0 }, { "textureSize", 1, 0, 0 },
+    { "texture", 0, 0, 1 }, { "texture2D", 0, 0, 1 }, { "textureLod", 0, 0, 1 }, { "textureGrad", 0, 0, 1 },
+    { "textureOffset", 0, 0, 1 }, { "textureProj", 0, 0, 1 }, { "texelFetch", 0, 0, 1 },
+    { "texelFetchOffset", 0, 0, 1 },
+};
+
+// Constructors and casts are free
+static bool isTypeName(const std::string& name) {
+    static const std::set<std::string> types = {
+        "float", "int", "uint", "bool", "vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3",
+        "uvec4", "bvec2", "bvec3", "bvec4", "mat2", "mat3", "mat4", "mat2x2", "mat2x3", "mat2x4", "mat3x2",
+        "mat3x3", "mat3x4", "mat4x2", "mat4x3", "mat4x4",
+    };
+    return types.count(name) != 0;
+}
+
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+struct CostToken {
+    enum Kind { Identifier, Number, Symbol };
+    Kind kind;
+    std::string text;
+    double value;   // Numbers only
+};
+
+static bool isSymbol(const CostToken& token, const char* text) {
+    return token.kind == CostToken::Symbol && token.text == text;
+}
+
+static bool isWord(const CostToken& token, const char* text) {
+    return token.kind == CostToken::Identifier && token.text == text;
+}
+
+static std::vector<CostToken> tokenize(const std::string& code) {
+    static const char* pairs[] = {
+        "<=", ">=", "==", "!=", "&&", "||", "^^", "++", "--", "+=", "-=", "*=", "/=", "%=", "<<", ">>",
+    };
+    std::vector<CostToken> tokens;
+    size_t i = 0;
+    while (i < code.size()) {
+        char c = code[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            while (i < code.size() && isIdentifierChar(code[i])) i++;
+            tokens.push_back(CostToken{ CostToken::Identifier, code.substr(start, i - start), 0.0 });
+            continue;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && i + 1 < code.size() && std::isdigit(static_cast<unsigned char>(code[i + 1])))) {
+            char* end = nullptr;
+            double value = std::strtod(code.c_str() + i, &end);
+            i = std::max(i + 1, static_cast<size_t>(end - code.c_str()));
+            // Type suffixes (1u, 1.0f, 1.0lf)
+            while (i < code.size() && isIdentifierChar(code[i])) i++;
+            tokens.push_back(CostToken{ CostToken::Number, code.substr(start, i - start), value });
+            continue;
+        }
+        std::string text(1, c);
+        for (const char* pair : pairs) {
+            if (code.compare(i, 2, pair) == 0) {
+                text = pair;
+                break;
+            }
+        }
+        i += text.size();
+        tokens.push_back(CostToken{ CostToken::Symbol, text, 0.0 });
+    }
+    return tokens;
+}
+
+// Comments become spaces; line breaks inside them stay so directives keep their lines
+static std::string stripComments(const std::string& code) {
+    std::string result;
+    result.reserve(code.size());
+    size_t i = 0;
+    while (i < code.size()) {
+        if (code.compare(i, 2, "//") == 0) {
+            size_t end = code.find('\n', i);
+            i = end == std::string::npos ? code.size() : end;
+            result += ' ';
+        }
+        else if (code.compare(i, 2, "/*") == 0) {
+            size_t end = code.find("*/", i + 2);
+            end = end == std::string::npos ? code.size() : end + 2;
+            result += ' ';
+            result.append(static_cast<size_t>(std::count(code.begin() + i, code.begin() + end, '\n')), '\n');
+            i = end;
+        }
+        else {
+            result += code[i++];
+        }
+    }
+    return result;
+}
+
+typedef std::function<bool(const std::string&, double&)> ConstantLookup;
+
+// Value of a constant expression over tokens [begin, end): numbers, named constants
+// from the lookup, arithmetic, comparisons, logic and a few built-ins. Fails on anything
+// it cannot work out (uniforms, variables, vectors).
+class ConstantEvaluator {
+public:
+    ConstantEvaluator(const std::vector<CostToken>& tokens, size_t begin, size_t end, const ConstantLookup& lookup)
+        : tokens(tokens), position(begin), end(end), lookup(lookup), ok(true) {
+    }
+
+    bool evaluate(double& value) {
+        value = parseBinary(0);
+        return ok && position == end;
+    }
+
+private:
+    const std::vector<CostToken>& tokens;
+    size_t position;
+    size_t end;
+    const ConstantLookup& lookup;
+    bool ok;
+
+    static const int LEVELS = 6;
+
+    // Binding strength of a binary operator, lowest first, -1 for none
+    static int levelOf(const CostToken& token) {
+        static const char* levels[LEVELS][4] = {
+            { "||", "^^" }, { "&&" }, { "==", "!=" }, { "<", ">", "<=", ">=" }, { "+", "-" }, { "*", "/", "%" },
+        };
+        if (token.kind != CostToken::Symbol) {
+            return -1;
+        }
+        for (int level = 0; level < LEVELS; level++) {
+            for (const char* op : levels[level]) {
+                if (op && token.text == op) {
+                    return level;
+                }
+            }
+        }
+        return -1;
+    }
+
+    double apply(const std::string& op, double a, double b) {
+        if (op == "||") return (a != 0.0 || b != 0.0) ? 1.0 : 0.0;
+        if (op == "^^") return ((a != 0.0) != (b != 0.0)) ? 1.0 : 0.0;
+        if (op == "&&") return (a != 0.0 && b != 0.0) ? 1.0 : 0.0;
+        if (op == "==") return a == b ? 1.0 : 0.0;
+        if (op == "!=") return a != b ? 1.0 : 0.0;
+        if (op == "<") return a < b ? 1.0 : 0.0;
+        if (op == ">") return a > b ? 1.0 : 0.0;
+        if (op == "<=") return a <= b ? 1.0 : 0.0;
+        if (op == ">=") return a >= b ? 1.0 : 0.0;
+        if (op == "+") return a + b;
+        if (op == "-") return a - b;
+        if (op == "*") return a * b;
+        if (b == 0.0) {
+            ok = false;
+            return 0.0;
+        }
+        return op == "/" ? a / b : std::fmod(a, b);
+    }
+
+    double parseBinary(int level) {
+        if (level == LEVELS) {
+            return parseUnary();
+        }
+        double left = parseBinary(level + 1);
+        while (ok && position < end && levelOf(tokens[position]) == level) {
+            std::string op = tokens[position++].text;
+            double right = parseBinary(level + 1);
+            left = apply(op, left, right);
+        }
+        return left;
+    }
+
+    double parseUnary() {
+        if (position < end && (isSymbol(tokens[position], "-") || isSymbol(tokens[position], "+") ||
+            isSymbol(tokens[position], "!"))) {
+            std::string op = tokens[position++].text;
+            double value = parseUnary();
+            return op == "-" ? -value : op == "!" ? (value == 0.0 ? 1.0 : 0.0) : value;
+        }
+        return parsePrimary();
+    }
+
+    double parsePrimary() {
+        if (position >= end) {
+            ok = false;
+            return 0.0;
+        }
+        const CostToken& token = tokens[position++];
+        if (token.kind == CostToken::Number) {
+            return token.value;
+        }
+        if (isSymbol(token, "(")) {
+            double value = parseBinary(0);
+            expect(")");
+            return value;
+        }
+        if (token.kind != CostToken::Identifier) {
+            ok = false;
+            return 0.0;
+        }
+        if (position < end && isSymbol(tokens[position], "(")) {
+            position++;
+            std::vector<double> arguments;
+            while (ok && position < end && !isSymbol(tokens[position], ")")) {
+                arguments.push_back(parseBinary(0));
+                if (position < end && isSymbol(tokens[position], ",")) {
+                    position++;
+                }
+                else {
+                    break;
+                }
+            }
+            expect(")");
+            return call(token.text, arguments);
+        }
+        double value = 0.0;
+        if (!lookup(token.text, value)) {
+            ok = false;
+        }
+        return value;
+    }
+
+    double call(const std::string& name, const std::vector<double>& arguments) {
+        if (arguments.size() == 1) {
+            double x = arguments[0];
+            if (name == "float" || name == "uint") return x;
+            if (name == "int") return std::trunc(x);
+            if (name == "abs") return std::fabs(x);
+            if (name == "floor") return std::floor(x);
+            if (name == "ceil") return std::ceil(x);
+        }
+        if (arguments.size() == 2) {
+            if (name == "min") return std::min(arguments[0], arguments[1]);
+            if (name == "max") return std::max(arguments[0], arguments[1]);
+        }
+        ok = false;
+        return 0.0;
+    }
+
+    void expect(const char* symbol) {
+        if (position < end && isSymbol(tokens[position], symbol)) {
+            position++;
+        }
+        else {
+            ok = false;
+        }
+    }
+};
+
+// Object-like macros of a shader; function-like ones are only known to be defined
+struct MacroTable {
+    std::map<std::string, std::string> values;
+    std::set<std::string> functions;
+
+    bool isDefined(const std::string& name) const {
+        return values.count(name) != 0 || functions.count(name) != 0;
+    }
+};
+
+static void expandMacros(const std::vector<CostToken>& input, const MacroTable& macros, int depth,
+    std::vector<CostToken>& output) {
+    for (const CostToken& token : input) {
+        std::map<std::string, std::string>::const_iterator macro =
+            token.kind == CostToken::Identifier ? macros.values.find(token.text) : macros.values.end();
+        if (macro == macros.values.end() || depth >= MAX_EXPANSION_DEPTH) {
+            output.push_back(token);
+            continue;
+        }
+        expandMacros(tokenize(macro->second), macros, depth + 1, output);
+    }
+}
+
+// #if / #elif condition: defined() resolved first, undefined names count as 0 like in C
+static bool evaluateCondition(const std::string& text, const MacroTable& macros) {
+    std::vector<CostToken> tokens = tokenize(text);
+    std::vector<CostToken> resolved;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (!isWord(tokens[i], "defined")) {
+            resolved.push_back(tokens[i]);
+            continue;
+        }
+        bool parenthesized = i + 1 < tokens.size() && isSymbol(tokens[i + 1], "(");
+        size_t name = i + (parenthesized ? 2 : 1);
+        bool defined = name < tokens.size() && macros.isDefined(tokens[name].text);
+        resolved.push_back(CostToken{ CostToken::Number, defined ? "1" : "0", defined ? 1.0 : 0.0 });
+        i = name + (parenthesized ? 1 : 0);
+    }
+
+    std::vector<CostToken> expanded;
+    expandMacros(resolved, macros, 0, expanded);
+    ConstantLookup undefinedIsZero = [](const std::string&, double& value) {
+        value = 0.0;
+        return true;
+    };
+    double value = 0.0;
+    ConstantEvaluator evaluator(expanded, 0, expanded.size(), undefinedIsZero);
+    return evaluator.evaluate(value) && value != 0.0;
+}
+
+// Tokens of the code that is compiled: inactive #if branches dropped, macros expanded
+static std::vector<CostToken> preprocess(const std::string& code) {
+    struct Conditional {
+        bool active;        // Lines are compiled
+        bool taken;         // A branch of this #if was active already
+        bool parentActive;
+    };
+    std::vector<Conditional> conditionals;
+    MacroTable macros;
+    std::vector<CostToken> output;
+
+    std::istringstream input(stripComments(code));
+    std::string line;
+    while (std::getline(input, line)) {
+        bool active = conditionals.empty() || conditionals.back().active;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            continue;
+        }
+        if (line[start] != '#') {
+            if (active) {
+                expandMacros(tokenize(line), macros, 0, output);
+            }
+            continue;
+        }
+
+        size_t nameStart = line.find_first_not_of(" \t", start + 1);
+        size_t nameEnd = nameStart;
+        while (nameEnd < line.size() && isIdentifierChar(line[nameEnd])) nameEnd++;
+        std::string directive = nameStart == std::string::npos ? "" : line.substr(nameStart, nameEnd - nameStart);
+        std::string rest = nameStart == std::string::npos ? "" : line.substr(nameEnd);
+
+        if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+            bool condition = false;
+            if (active) {
+                std::vector<CostToken> name = tokenize(rest);
+                if (directive == "if") {
+                    condition = evaluateCondition(rest, macros);
+                }
+                else {
+                    condition = !name.empty() && macros.isDefined(name[0].text) == (directive == "ifdef");
+                }
+            }
+            conditionals.push_back(Conditional{ condition, condition, active });
+        }
+        else if (directive == "elif" && !conditionals.empty()) {
+            Conditional& top = conditionals.back();
+            top.active = top.parentActive && !top.taken && evaluateCondition(rest, macros);
+            top.taken = top.taken || top.active;
+        }
+        else if (directive == "else" && !conditionals.empty()) {
+            Conditional& top = conditionals.back();
+            top.active = top.parentActive && !top.taken;
+            top.taken = true;
+        }
+        else if (directive == "endif" && !conditionals.empty()) {
+            conditionals.pop_back();
+        }
+        else if (directive == "define" && active) {
+            size_t macroStart = rest.find_first_not_of(" \t");
+            size_t macroEnd = macroStart;
+            while (macroEnd < rest.size() && isIdentifierChar(rest[macroEnd])) macroEnd++;
+            if (macroStart == std::string::npos || macroEnd == macroStart) {
+                continue;
+            }
+            std::string name = rest.substr(macroStart, macroEnd - macroStart);
+            if (macroEnd < rest.size() && rest[macroEnd] == '(') {
+                macros.functions.insert(name);
+            }
+            else {
+                macros.values[name] = rest.substr(macroEnd);
+            }
+        }
+        else if (directive == "undef" && active) {
+            std::vector<CostToken> name = tokenize(rest);
+            if (!name.empty()) {
+                macros.values.erase(name[0].text);
+                macros.functions.erase(name[0].text);
+            }
+        }
+        // #version, #extension, #pragma and the like change nothing here
+    }
+    return output;
+}
+
+// Walks the preprocessed code from mainImage(), adding up operations with every called
+// function inlined and every loop body multiplied by its trip count
+class CostWalker {
+public:
+    explicit CostWalker(const std::vector<CostToken>& tokens) : tokens(tokens) {
+        findDeclarations();
+    }
+
+    bool hasFunction(const std::string& name) const {
+        return functions.count(name) != 0;
+    }
+
+    // Dearest overload of a function
+    ShaderCost functionCost(const std::string& name) {
+        std::map<std::string, ShaderCost>::const_iterator known = memo.find(name);
+        if (known != memo.end()) {
+            return known->second;
+        }
+        // GLSL has no recursion; a cycle means a misread call, count it as free
+        if (!active.insert(name).second) {
+            return ShaderCost();
+        }
+
+        std::map<std::string, double> callerLocals;
+        callerLocals.swap(locals);
+        ShaderCost cost;
+        bool first = true;
+        auto range = functions.equal_range(name);
+        for (auto overload = range.first; overload != range.second; ++overload) {
+            locals.clear();
+            ShaderCost body = statementsCost(overload->second.first, overload->second.second);
+            cost = first ? body : dearer(cost, body);
+            first = false;
+        }
+        locals.swap(callerLocals);
+
+        active.erase(name);
+        memo[name] = cost;
+        return cost;
+    }
+
+private:
+    const std::vector<CostToken>& tokens;
+    std::multimap<std::string, std::pair<size_t, size_t>> functions;    // Body token ranges
+    std::map<std::string, double> globals;      // Constants at file scope
+    std::map<std::string, double> locals;       // ... and in the function being walked
+    std::map<std::string, ShaderCost> memo;
+    std::set<std::string> active;
+
+    // Index of the bracket closing the one at open, or the end of the tokens
+    size_t matching(size_t open, size_t end) const {
+        const std::string& opening = tokens[open].text;
+        const char* closing = opening == "(" ? ")" : opening == "[" ? "]" : "}";
+        int depth = 0;
+        for (size_t i = open; i < end; i++) {
+            if (isSymbol(tokens[i], opening.c_str())) {
+                depth++;
+            }
+            else if (isSymbol(tokens[i], closing) && --depth == 0) {
+                return i;
+            }
+        }
+        return end;
+    }
+
+    bool evaluate(size_t begin, size_t end, double& value) const {
+        ConstantLookup lookup = [this](const std::string& name, double& result) {
+            std::map<std::string, double>::const_iterator local = locals.find(name);
+            if (local != locals.end()) {
+                result = local->second;
+                return true;
+            }
+            std::map<std::string, double>::const_iterator global = globals.find(name);
+            if (global != globals.end()) {
+                result = global->second;
+                return true;
+            }
+            return false;
+        };
+        ConstantEvaluator evaluator(tokens, begin, end, lookup);
+        return begin < end && evaluator.evaluate(value);
+    }
+
+    // "type name = value" with a constant value, at i: remembered in the given table so
+    // loop bounds can refer to it. Variables count too: a rough bound beats a guess.
+    void recordDeclaration(size_t i, size_t end, std::map<std::string, double>& table) const {
+        while (i < end && (isWord(tokens[i], "const") || isWord(tokens[i], "highp") ||
+            isWord(tokens[i], "mediump") || isWord(tokens[i], "lowp"))) {
+            i++;
+        }
+        if (i + 3 >= end || !(isWord(tokens[i], "int") || isWord(tokens[i], "float") || isWord(tokens[i], "uint")) ||
+            tokens[i + 1].kind != CostToken::Identifier || !isSymbol(tokens[i + 2], "=")) {
+            return;
+        }
+        size_t valueEnd = i + 3;
+        int depth = 0;
+        for (; valueEnd < end; valueEnd++) {
+            if (isSymbol(tokens[valueEnd], "(")) depth++;
+            else if (isSymbol(tokens[valueEnd], ")")) depth--;
+            else if (depth == 0 && (isSymbol(tokens[valueEnd], ";") || isSymbol(tokens[valueEnd], ","))) break;
+        }
+        double value = 0.0;
+        if (evaluate(i + 3, valueEnd, value)) {
+            table[tokens[i + 1].text] = value;
+        }
+    }
+
+    // Function bodies and file scope constants
+    void findDeclarations() {
+        size_t count = tokens.size();
+        size_t statementStart = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (isSymbol(tokens[i], ";")) {
+                recordDeclaration(statementStart, i, globals);
+                statementStart = i + 1;
+            }
+            else if (isSymbol(tokens[i], "{")) {
+                // "type name(...) {" is a function, anything else (structs) is skipped whole
+                size_t close = matching(i, count);
+                if (i >= 3 && isSymbol(tokens[i - 1], ")")) {
+                    int depth = 0;
+                    size_t open = i - 1;
+                    for (; open > statementStart; open--) {
+                        if (isSymbol(tokens[open], ")")) depth++;
+                        else if (isSymbol(tokens[open], "(") && --depth == 0) break;
+                    }
+                    if (open > statementStart && tokens[open - 1].kind == CostToken::Identifier) {
+                        functions.insert(std::make_pair(tokens[open - 1].text, std::make_pair(i + 1, close)));
+                    }
+                }
+                i = close;
+                statementStart = close + 1;
+            }
+        }
+    }
+
+    // Index after the statement starting at i
+    size_t statementEnd(size_t i, size_t end) const {
+        if (i >= end) {
+            return end;
+        }
+        if (isSymbol(tokens[i], "{")) {
+            return std::min(matching(i, end) + 1, end);
+        }
+        if ((isWord(tokens[i], "for") || isWord(tokens[i], "while")) && i + 1 < end && isSymbol(tokens[i + 1], "(")) {
+            return statementEnd(matching(i + 1, end) + 1, end);
+        }
+        if (isWord(tokens[i], "if") && i + 1 < end && isSymbol(tokens[i + 1], "(")) {
+            size_t after = statementEnd(matching(i + 1, end) + 1, end);
+            if (after < end && isWord(tokens[after], "else")) {
+                return statementEnd(after + 1, end);
+            }
+            return after;
+        }
+        if (isWord(tokens[i], "do")) {
+            // do body while (condition);
+            return statementEnd(statementEnd(i + 1, end), end);
+        }
+        int depth = 0;
+        for (size_t k = i; k < end; k++) {
+            const CostToken& token = tokens[k];
+            if (isSymbol(token, "(") || isSymbol(token, "[") || isSymbol(token, "{")) {
+                depth++;
+            }
+            else if (isSymbol(token, ")") || isSymbol(token, "]") || isSymbol(token, "}")) {
+                depth--;
+            }
+            else if (isSymbol(token, ";") && depth == 0) {
+                return k + 1;
+            }
+        }
+        return end;
+    }
+
+    ShaderCost statementsCost(size_t begin, size_t end) {
+        ShaderCost cost;
+        size_t i = begin;
+        while (i < end) {
+            size_t next = statementEnd(i, end);
+            cost += statementCost(i, next);
+            i = std::max(next, i + 1);
+        }
+        return cost;
+    }
+
+    ShaderCost statementCost(size_t begin, size_t end) {
+        if (begin >= end) {
+            return ShaderCost();
+        }
+        const CostToken& first = tokens[begin];
+        if (isSymbol(first, "{")) {
+            return statementsCost(begin + 1, matching(begin, end));
+        }
+        bool header = begin + 1 < end && isSymbol(tokens[begin + 1], "(");
+        if (isWord(first, "for") && header) {
+            return forCost(begin + 2, matching(begin + 1, end), end);
+        }
+        if (isWord(first, "while") && header) {
+            size_t close = matching(begin + 1, end);
+            return guessedLoop(expressionCost(begin + 2, close), statementCost(close + 1, end));
+        }
+        if (isWord(first, "do")) {
+            size_t bodyEnd = statementEnd(begin + 1, end);
+            return guessedLoop(expressionCost(bodyEnd + 1, end), statementCost(begin + 1, bodyEnd));
+        }
+        if (isWord(first, "if") && header) {
+            size_t close = matching(begin + 1, end);
+            size_t thenEnd = statementEnd(close + 1, end);
+            ShaderCost branches = statementCost(close + 1, thenEnd);
+            if (thenEnd < end && isWord(tokens[thenEnd], "else")) {
+                branches = dearer(branches, statementCost(thenEnd + 1, end));
+            }
+            ShaderCost cost = expressionCost(begin + 2, close);
+            cost += branches;
+            return cost;
+        }
+        recordDeclaration(begin, end, locals);
+        return expressionCost(begin, end);
+    }
+
+    ShaderCost guessedLoop(const ShaderCost& condition, const ShaderCost& body) {
+        ShaderCost iteration = condition;
+        iteration += body;
+        ShaderCost cost = repeated(iteration, GUESSED_TRIPS);
+        cost.loops++;
+        cost.guessedLoops++;
+        return cost;
+    }
+
+    // "for (init; condition; step) body", headerBegin / headerEnd inside the parentheses
+    ShaderCost forCost(size_t headerBegin, size_t headerEnd, size_t end) {
+        size_t semicolons[2] = { headerEnd, headerEnd };
+        int found = 0;
+        int depth = 0;
+        for (size_t i = headerBegin; i < headerEnd && found < 2; i++) {
+            if (isSymbol(tokens[i], "(")) depth++;
+            else if (isSymbol(tokens[i], ")")) depth--;
+            else if (isSymbol(tokens[i], ";") && depth == 0) semicolons[found++] = i;
+        }
+        size_t conditionBegin = std::min(semicolons[0] + 1, headerEnd);
+        size_t stepBegin = std::min(semicolons[1] + 1, headerEnd);
+
+        recordDeclaration(headerBegin, semicolons[0], locals);
+        ShaderCost cost = expressionCost(headerBegin, semicolons[0]);
+        ShaderCost iteration = expressionCost(conditionBegin, semicolons[1]);
+        iteration += expressionCost(stepBegin, headerEnd);
+        iteration += statementCost(headerEnd + 1, end);
+
+        double trips = tripCount(headerBegin, semicolons[0], conditionBegin, semicolons[1], stepBegin, headerEnd);
+        cost += repeated(iteration, trips < 0.0 ? GUESSED_TRIPS : trips);
+        cost.loops++;
+        if (trips < 0.0) {
+            cost.guessedLoops++;
+        }
+        return cost;
+    }
+
+    // Range is a lone variable, maybe with ++ / -- around it; gives its name and that step
+    bool loneVariable(size_t begin, size_t end, std::string& name, double& step) const {
+        step = 0.0;
+        if (begin < end && (isSymbol(tokens[begin], "++") || isSymbol(tokens[begin], "--"))) {
+            step = isSymbol(tokens[begin], "++") ? 1.0 : -1.0;
+            begin++;
+        }
+        if (end > begin && (isSymbol(tokens[end - 1], "++") || isSymbol(tokens[end - 1], "--"))) {
+            step = isSymbol(tokens[end - 1], "++") ? 1.0 : -1.0;
+            end--;
+        }
+        if (end != begin + 1 || tokens[begin].kind != CostToken::Identifier) {
+            return false;
+        }
+        name = tokens[begin].text;
+        return true;
+    }
+
+    // Iterations of a for loop from its header, -1 when they cannot be worked out.
+    // Handles "i < N" style conditions (the tightest one of an && chain), additive steps
+    // and multiplicative ones ("s *= 2.0").
+    double tripCount(size_t initBegin, size_t initEnd, size_t conditionBegin, size_t conditionEnd,
+        size_t stepBegin, size_t stepEnd) const {
+        // Loop variable and start value, 0 when unknown (ZERO style macros hide it from the compiler)
+        std::string variable;
+        double start = 0.0;
+        for (size_t i = initBegin; i < initEnd; i++) {
+            if (isSymbol(tokens[i], "=") && i > initBegin && tokens[i - 1].kind == CostToken::Identifier) {
+                variable = tokens[i - 1].text;
+                size_t valueEnd = i + 1;
+                while (valueEnd < initEnd && !isSymbol(tokens[valueEnd], ",")) valueEnd++;
+                if (!evaluate(i + 1, valueEnd, start)) {
+                    start = 0.0;
+                }
+                break;
+            }
+        }
+        if (variable.empty() && initEnd > initBegin && tokens[initEnd - 1].kind == CostToken::Identifier) {
+            variable = tokens[initEnd - 1].text;  // "float i" without a value
+        }
+
+        double best = -1.0;
+        size_t partBegin = conditionBegin;
+        int depth = 0;
+        for (size_t i = conditionBegin; i <= conditionEnd; i++) {
+            if (i < conditionEnd) {
+                if (isSymbol(tokens[i], "(")) depth++;
+                else if (isSymbol(tokens[i], ")")) depth--;
+                if (!(depth == 0 && isSymbol(tokens[i], "&&"))) {
+                    continue;
+                }
+            }
+            double trips = conditionTrips(partBegin, i, variable, start, stepBegin, stepEnd);
+            if (trips >= 0.0 && (best < 0.0 || trips < best)) {
+                best = trips;
+            }
+            partBegin = i + 1;
+        }
+        return best < 0.0 ? -1.0 : std::min(best, MAX_TRIPS);
+    }
+
+    // Trips allowed by one comparison of the condition, -1 if it does not bound the variable
+    double conditionTrips(size_t begin, size_t end, std::string variable, double start,
+        size_t stepBegin, size_t stepEnd) const {
+        // Strip parentheses around the whole comparison
+        while (end > begin + 1 && isSymbol(tokens[begin], "(") && matching(begin, end) == end - 1) {
+            begin++;
+            end--;
+        }
+        size_t compare = end;
+        for (size_t i = begin; i < end; i++) {
+            if (isSymbol(tokens[i], "<") || isSymbol(tokens[i], ">") || isSymbol(tokens[i], "<=") ||
+                isSymbol(tokens[i], ">=")) {
+                compare = i;
+                break;
+            }
+        }
+        if (compare == end) {
+            return -1.0;
+        }
+
+        std::string op = tokens[compare].text;
+        std::string name;
+        double conditionStep = 0.0;
+        double bound = 0.0;
+        bool onLeft = loneVariable(begin, compare, name, conditionStep) && (variable.empty() || name == variable) &&
+            evaluate(compare + 1, end, bound);
+        if (!onLeft) {
+            if (!loneVariable(compare + 1, end, name, conditionStep) || (!variable.empty() && name != variable) ||
+                !evaluate(begin, compare, bound)) {
+                return -1.0;
+            }
+            // "N > i" is "i < N"
+            op = op == "<" ? ">" : op == ">" ? "<" : op == "<=" ? ">=" : "<=";
+        }
+        variable = name;
+
+        // Step: from the step expression, else the ++ / -- in the condition
+        double step = conditionStep;
+        bool multiply = false;
+        if (stepEnd > stepBegin) {
+            std::string stepName;
+            double stepValue = 0.0;
+            if (loneVariable(stepBegin, stepEnd, stepName, stepValue) && stepName == variable && stepValue != 0.0) {
+                step = stepValue;
+            }
+            else if (stepEnd > stepBegin + 2 && isWord(tokens[stepBegin], variable.c_str()) &&
+                evaluate(stepBegin + 2, stepEnd, stepValue)) {
+                const CostToken& assign = tokens[stepBegin + 1];
+                if (isSymbol(assign, "+=")) step = stepValue;
+                else if (isSymbol(assign, "-=")) step = -stepValue;
+                else if (isSymbol(assign, "*=")) { step = stepValue; multiply = true; }
+                else return -1.0;
+            }
+            else if (step == 0.0) {
+                return -1.0;
+            }
+        }
+
+        bool upwards = op == "<" || op == "<=";
+        bool inclusive = op == "<=" || op == ">=";
+        if (multiply) {
+            // Geometric: start * step^n crosses the bound
+            double ratio = upwards ? bound / start : start / bound;
+            double factor = upwards ? step : 1.0 / step;
+            if (start <= 0.0 || bound <= 0.0 || factor <= 1.0) {
+                return -1.0;
+            }
+            double distance = std::log(ratio) / std::log(factor);
+            return std::max(0.0, inclusive ? std::floor(distance + 1e-9) + 1.0 : std::ceil(distance - 1e-9));
+        }
+        if (step == 0.0 || (step > 0.0) != upwards) {
+            return -1.0;
+        }
+        double distance = (bound - start) / step;
+        double trips = inclusive ? std::floor(distance + 1e-9) + 1.0 : std::ceil(distance - 1e-9);
+        return std::max(0.0, trips);
+    }
+
+    ShaderCost expressionCost(size_t begin, size_t end) {
+        static const std::set<std::string> operators = {
+            "+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||", "^^", "!",
+            "++", "--", "+=", "-=", "*=", "/=", "%=", "?", "&", "|", "^", "~", "<<", ">>",
+        };
+        ShaderCost cost;
+        for (size_t i = begin; i < end; i++) {
+            const CostToken& token = tokens[i];
+            if (token.kind == CostToken::Symbol) {
+                if (operators.count(token.text)) {
+                    cost.alu += 1.0;
+                }
+                continue;
+            }
+            if (token.kind != CostToken::Identifier || i + 1 >= end || !isSymbol(tokens[i + 1], "(")) {
+                continue;
+            }
+            if (isTypeName(token.text)) {
+                continue;
+            }
+            if (functions.count(token.text)) {
+                cost += functionCost(token.text);
+                continue;
+            }
+            const BuiltinCost* builtin = nullptr;
+            for (const BuiltinCost& candidate : builtinCosts) {
+                if (token.text == candidate.name) {
+                    builtin = &candidate;
+                    break;
+                }
+            }
+            if (builtin) {
+                cost.alu += builtin->alu;
+                cost.transcendental += builtin->transcendental;
+                cost.texture += builtin->texture;
+            }
+            else {
+                cost.alu += 1.0;
+            }
+        }
+        return cost;
+    }
+};
+
+ShaderCost estimateShaderCost(const std::string& shaderToyCode, const std::string& defineBlock) {
+    std::vector<CostToken> tokens = preprocess(defineBlock + shaderToyCode);
+    CostWalker walker(tokens);
+    if (!walker.hasFunction("mainImage")) {
+        return ShaderCost();
+    }
+    return walker.functionCost("mainImage");
+}
+
+ShaderCost estimateShaderFileCost(const std::string& imagePath, const std::string& defineBlock) {
+    // The files are read on every call so an edit is never estimated from stale text;
+    // only the estimate itself is kept, keyed by the hash of everything it was made from
+    static std::map<uint64_t, ShaderCost> estimates;
+
+    std::vector<std::string> paths(1, normalizeShaderPath(imagePath));
+    std::vector<std::string> passes;
+    uint64_t hash = hashBytes(defineBlock.data(), defineBlock.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string code = loadShaderFromFile(paths[i]);
+        if (code.empty()) {
+            continue;
+        }
+        ShaderToySource parsed = parseShaderToySource(code, paths[i]);
+        hash = hashBytes(paths[i].data(), paths[i].size(), hash);
+        hash = hashBytes(parsed.code.data(), parsed.code.size(), hash);
+        passes.push_back(parsed.code);
+        for (const ChannelInput& input : parsed.channels) {
+            if (input.type == ChannelInput::Buffer && std::find(paths.begin(), paths.end(), input.path) == paths.end()) {
+                paths.push_back(input.path);
+            }
+        }
+    }
+
+    std::map<uint64_t, ShaderCost>::const_iterator known = estimates.find(hash);
+    if (known != estimates.end()) {
+        return known->second;
+    }
+    ShaderCost total;
+    for (const std::string& pass : passes) {
+        total += estimateShaderCost(pass, defineBlock);
+    }
+    estimates[hash] = total;
+    return total;
+}
+
+void printShaderCostReport(const std::vector<std::string>& names, const std::vector<ShaderCost>& costs) {
+    std::cout << "Estimated operations per pixel (loops at their limits):" << std::endl;
+    std::cout << "  " << std::left << std::setw(20) << "shader" << std::right << std::setw(10) << "ALU"
+        << std::setw(8) << "trans" << std::setw(8) << "tex" << std::setw(7) << "loops" << std::setw(9) << "guessed"
+        << std::setw(8) << "score" << std::endl;
+    std::cout << std::fixed;
+    for (size_t i = 0; i < names.size() && i < costs.size(); i++) {
+        const ShaderCost& cost = costs[i];
+        std::cout << "  " << std::left << std::setw(20) << names[i] << std::right << std::setprecision(0)
+            << std::setw(10) << cost.alu << std::setw(8) << cost.transcendental << std::setw(8) << cost.texture
+            << std::setw(7) << cost.loops << std::setw(9) << cost.guessedLoops << std::setprecision(2)
+            << std::setw(8) << cost.getScore() << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
@@ -0,0 +1,68 @@
+#include "../include/shader_loading.h"
+
+void loadShader(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, int index,
+    TextureCache* textureCache) {
+    if (pipelines[index].isLoaded()) {
+        return;
+    }
+    std::string shaderPath = registry.getPath(index);
+    std::cout << "Loading shader from: " << shaderPath << std::endl;
+    std::string code = loadShaderFromFile(shaderPath);
+    if (!pipelines[index].load(code, shaderPath, textureCache, registry.getDefineBlock(index))) {
+        std::cerr << "Failed to load shader " << (index+1) << " (" << registry.getName(index) << ")!" << std::endl;
+    }
+}
+
+void loadShaders(std::vector<MultipassPipeline>& pipelines, const ShaderRegistry& registry, TextureCache* textureCache) {
+    for (int i = 0; i < static_cast<int>(pipelines.size()); i++) {
+        loadShader(pipelines, registry, i, textureCache);
+    }
+}
+
+double millisecondsSince(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void submitShader(std::vector<MultipassPipeline>& pipelines, int index, ProgramBinaryCache* cache) {
+    std::cout << "Submitting shader " << (index+1) << "..." << std::endl;
+    pipelines[index].submit(cache);
+}
+
+void submitShaders(std::vector<MultipassPipeline>& pipelines, ProgramBinaryCache* cache,
+    const std::vector<int>& order) {
+    for (int n = 0; n < static_cast<int>(pipelines.size()); n++) {
+        int i = order.empty() ? n : order[n];
+        if (pipelines[i].isLoaded()) {
+            submitShader(pipelines, i, cache);
+        }
+    }
+}
+
+bool compileShaders(std::vector<MultipassPipeline>& pipelines, ProgramBinaryCache* cache) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    submitShaders(pipelines, cache);
+    int compiled = 0;
+    for (int i = 0; i < static_cast<int>(pipelines.size()); i++) {
+        if (!pipelines[i].isLoaded()) {
+            continue;
+        }
+        compiled++;
+        pipelines[i].poll(true);
+        if (pipelines[i].hasFailed()) {
+            std::cerr << "Failed to load shader " << (i+1) << "!" << std::endl;
+            return false;
+        }
+    }
+    std::cout << "All " << compiled << " shaders compiled successfully in " << millisecondsSince(start) << " ms";
+    if (cache && cache->isEnabled()) {
+        std::cout << " (" << cache->getHits() << " from binary cache, " << cache->getMisses() << " compiled)";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+void initBinaryCache(const Options& options, ProgramBinaryCache& cache) {
+    if (options.useBinaryCache) {
+        cache.init();
+    }
+}
@@ -1,59 +1,258 @@
 #include "../include/shader_manager.h"
 
-ShaderManager::ShaderManager() : programID(0) {
+bool ShaderManager::parallelCompile = false;
+CompileWorker* ShaderManager::compileWorker = nullptr;
+
+ShaderManager::ShaderManager()
+    : programID(0), channelResolutionUniform(-1), fragCoordOffsetUniform(-1), pendingProgram(0), pendingVertexShader(0),
+      pendingFragmentShader(0), pendingCache(nullptr), pendingJob(0), failed(false) {
 }
 
 ShaderManager::~ShaderManager() {
+    releasePending();
     if (programID != 0) {
         glDeleteProgram(programID);
     }
 }
 
-bool ShaderManager::loadFromStrings(const std::string& vertexSource, const std::string& fragmentSource) {
-    // Create shader program
-    if (programID != 0) {
-        glDeleteProgram(programID);
+bool ShaderManager::enableParallelCompile() {
+    // 0xFFFFFFFF lets the driver pick the number of compiler threads
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallelCompile = true;
     }
-    
+    else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallelCompile = true;
+    }
+    else {
+        parallelCompile = false;
+    }
+    return parallelCompile;
+}
+
+bool ShaderManager::loadFromStrings(const std::string& vertexSource, const std::string& fragmentSource,
+    ProgramBinaryCache* cache) {
+    submit(vertexSource, fragmentSource, cache);
+    poll(true);
+    return !failed;
+}
+
+void ShaderManager::submit(const std::string& vertexSource, const std::string& fragmentSource,
+    ProgramBinaryCache* cache) {
+    // A newer submission replaces one that is still in flight
+    releasePending();
+    failed = false;
+
+    // Cached binary skips compiling and linking entirely
+    if (cache) {
+        GLuint cachedProgram = cache->load(vertexSource, fragmentSource);
+        if (cachedProgram != 0) {
+            setProgram(cachedProgram);
+            return;
+        }
+    }
+
+    // The cache key needs the sources once the link has finished
+    if (cache && cache->isEnabled()) {
+        pendingVertexSource = vertexSource;
+        pendingFragmentSource = fragmentSource;
+        pendingCache = cache;
+    }
+
+    // Hand the whole build to the worker thread, poll() picks up the result
+    if (compileWorker) {
+        pendingJob = compileWorker->enqueue(vertexSource, fragmentSource, pendingCache != nullptr);
+        return;
+    }
+
     // Vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    pendingVertexShader = glCreateShader(GL_VERTEX_SHADER);
     const char* vShaderCode = vertexSource.c_str();
-    glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-    glCompileShader(vertexShader);
-    if (!checkCompileErrors(vertexShader, "VERTEX")) {
-        glDeleteShader(vertexShader);
-        return false;
-    }
-    
+    glShaderSource(pendingVertexShader, 1, &vShaderCode, NULL);
+    glCompileShader(pendingVertexShader);
+
     // Fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    pendingFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     const char* fShaderCode = fragmentSource.c_str();
-    glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-    glCompileShader(fragmentShader);
-    if (!checkCompileErrors(fragmentShader, "FRAGMENT")) {
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return false;
+    glShaderSource(pendingFragmentShader, 1, &fShaderCode, NULL);
+    glCompileShader(pendingFragmentShader);
+
+    // Shader program - linked right away, compile status is only checked in poll()
+    pendingProgram = glCreateProgram();
+    if (cache && cache->isEnabled()) {
+        glProgramParameteri(pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
-    
-    // Shader program
-    programID = glCreateProgram();
-    glAttachShader(programID, vertexShader);
-    glAttachShader(programID, fragmentShader);
-    glLinkProgram(programID);
-    if (!checkLinkErrors(programID)) {
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+    glAttachShader(pendingProgram, pendingVertexShader);
+    glAttachShader(pendingProgram, pendingFragmentShader);
+    glLinkProgram(pendingProgram);
+}
+
+bool ShaderManager::poll(bool wait) {
+    if (pendingJob != 0) {
+        return pollWorker(wait);
+    }
+    if (pendingProgram == 0) {
+        return true;
+    }
+
+    if (!wait && parallelCompile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) {
+            return false;
+        }
+    }
+
+    finishPending();
+    return true;
+}
+
+bool ShaderManager::pollWorker(bool wait) {
+    GLuint program = 0;
+    while (!compileWorker->take(pendingJob, program)) {
+        if (!wait) {
+            return false;
+        }
+        SDL_Delay(1);
+    }
+    pendingJob = 0;
+
+    // The worker already printed the log of a failed build
+    failed = (program == 0);
+    if (!failed) {
+        if (pendingCache) {
+            pendingCache->store(program, pendingVertexSource, pendingFragmentSource);
+        }
+        setProgram(program);
+    }
+    releasePending();
+    return true;
+}
+
+void ShaderManager::finishPending() {
+    bool success = checkCompileErrors(pendingVertexShader, "VERTEX") &&
+        checkCompileErrors(pendingFragmentShader, "FRAGMENT") &&
+        checkLinkErrors(pendingProgram);
+
+    if (success) {
+        if (pendingCache) {
+            pendingCache->store(pendingProgram, pendingVertexSource, pendingFragmentSource);
+        }
+
+        // Swap in the new program only now that it is known to work
+        setProgram(pendingProgram);
+        pendingProgram = 0;
+    }
+    failed = !success;
+
+    releasePending();
+}
+
+void ShaderManager::swap(ShaderManager& other) {
+    std::swap(programID, other.programID);
+    uniforms.swap(other.uniforms);
+    std::swap(channelResolutionUniform, other.channelResolutionUniform);
+    std::swap(fragCoordOffsetUniform, other.fragCoordOffsetUniform);
+    std::swap(pendingProgram, other.pendingProgram);
+    std::swap(pendingVertexShader, other.pendingVertexShader);
+    std::swap(pendingFragmentShader, other.pendingFragmentShader);
+    pendingVertexSource.swap(other.pendingVertexSource);
+    pendingFragmentSource.swap(other.pendingFragmentSource);
+    std::swap(pendingCache, other.pendingCache);
+    std::swap(pendingJob, other.pendingJob);
+    std::swap(failed, other.failed);
+}
+
+void ShaderManager::setProgram(GLuint program) {
+    if (programID != 0) {
         glDeleteProgram(programID);
-        programID = 0;
-        return false;
     }
-    
+    programID = program;
+    reflectUniforms();
+}
+
+void ShaderManager::reflectUniforms() {
+    uniforms.clear();
+
+    if (programID != 0) {
+        // GLSL 3.30 has no layout(binding), so attach the globals block here
+        GLuint blockIndex = glGetUniformBlockIndex(programID, SHADERTOY_GLOBALS_BLOCK);
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(programID, blockIndex, SHADERTOY_GLOBALS_BINDING);
+        }
+
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++) {
+            UniformInfo info;
+            GLsizei length = 0;
+            glGetActiveUniform(programID, i, static_cast<GLsizei>(nameBuffer.size()), &length, &info.size, &info.type, nameBuffer.data());
+            info.name.assign(nameBuffer.data(), length);
+
+            // Members of uniform blocks have no location and are not set through here
+            info.location = glGetUniformLocation(programID, info.name.c_str());
+            if (info.location < 0) {
+                continue;
+            }
+
+            size_t bracket = info.name.find('[');
+            if (bracket != std::string::npos) {
+                info.name.erase(bracket);
+            }
+            uniforms.push_back(info);
+        }
+
+        // Samplers iChannel0-3 always read texture units 0-3
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        glUseProgram(programID);
+        for (int i = 0; i < 4; i++) {
+            setInt(getUniform("iChannel" + std::to_string(i)), i);
+        }
+        glUseProgram(previousProgram);
+    }
+
+    channelResolutionUniform = getUniform("iChannelResolution");
+    fragCoordOffsetUniform = getUniform("iFragCoordOffset");
+}
+
+UniformHandle ShaderManager::getUniform(const std::string& name) const {
+    for (const UniformInfo& info : uniforms) {
+        if (info.name == name) {
+            return info.location;
+        }
+    }
+    return -1;
+}
+
+void ShaderManager::releasePending() {
     // Delete shaders as they're linked into the program and no longer needed
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    
-    return true;
+    if (pendingVertexShader != 0) {
+        glDeleteShader(pendingVertexShader);
+        pendingVertexShader = 0;
+    }
+    if (pendingFragmentShader != 0) {
+        glDeleteShader(pendingFragmentShader);
+        pendingFragmentShader = 0;
+    }
+    if (pendingProgram != 0) {
+        glDeleteProgram(pendingProgram);
+        pendingProgram = 0;
+    }
+    if (pendingJob != 0) {
+        if (compileWorker) {
+            compileWorker->cancel(pendingJob);
+        }
+        pendingJob = 0;
+    }
+    pendingVertexSource.clear();
+    pendingFragmentSource.clear();
+    pendingCache = nullptr;
 }
 
 void ShaderManager::use() {
@@ -62,44 +261,60 @@ void ShaderManager::use() {
     }
 }
 
+void ShaderManager::setFloat(UniformHandle handle, float value) {
+    if (handle >= 0) {
+        glUniform1f(handle, value);
+    }
+}
+
+void ShaderManager::setInt(UniformHandle handle, int value) {
+    if (handle >= 0) {
+        glUniform1i(handle, value);
+    }
+}
+
+void ShaderManager::setVec2(UniformHandle handle, float x, float y) {
+    if (handle >= 0) {
+        glUniform2f(handle, x, y);
+    }
+}
+
+void ShaderManager::setVec3(UniformHandle handle, float x, float y, float z) {
+    if (handle >= 0) {
+        glUniform3f(handle, x, y, z);
+    }
+}
+
+void ShaderManager::setVec4(UniformHandle handle, float x, float y, float z, float w) {
+    if (handle >= 0) {
+        glUniform4f(handle, x, y, z, w);
+    }
+}
+
+void ShaderManager::setVec3Array(UniformHandle handle, const float* values, int count) {
+    if (handle >= 0) {
+        glUniform3fv(handle, count, values);
+    }
+}
+
 void ShaderManager::setFloat(const std::string& name, float value) {
-    glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+    setFloat(getUniform(name), value);
 }
 
 void ShaderManager::setInt(const std::string& name, int value) {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+    setInt(getUniform(name), value);
 }
 
 void ShaderManager::setVec2(const std::string& name, float x, float y) {
-    glUniform2f(glGetUniformLocation(programID, name.c_str()), x, y);
+    setVec2(getUniform(name), x, y);
 }
 
 void ShaderManager::setVec3(const std::string& name, float x, float y, float z) {
-    glUniform3f(glGetUniformLocation(programID, name.c_str()), x, y, z);
+    setVec3(getUniform(name), x, y, z);
 }
 
 void ShaderManager::setVec4(const std::string& name, float x, float y, float z, float w) {
-    glUniform4f(glGetUniformLocation(programID, name.c_str()), x, y, z, w);
-}
-
-void ShaderManager::setupShaderToyUniforms(int windowWidth, int windowHeight, float time, float deltaTime, int frame, int mouseX, int mouseY, bool mouseDown) {
-    use();
-    
-    // Set ShaderToy uniforms
-    setVec3("iResolution", (float)windowWidth, (float)windowHeight, 1.0f);
-    setFloat("iTime", time);
-    setFloat("iTimeDelta", deltaTime);
-    setInt("iFrame", frame);
-    
-    // Mouse position and click state
-    float mx = static_cast<float>(mouseX);
-    float my = static_cast<float>(windowHeight - mouseY); // Invert Y for ShaderToy compatibility
-    
-    if (mouseDown) {
-        setVec4("iMouse", mx, my, mx, my);
-    } else {
-        setVec4("iMouse", mx, my, 0.0f, 0.0f);
-    }
+    setVec4(getUniform(name), x, y, z, w);
 }
 
 bool ShaderManager::checkCompileErrors(GLuint shader, const std::string& type) {
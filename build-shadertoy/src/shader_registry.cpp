@@ -0,0 +1,509 @@
+#include "../include/shader_registry.h"
+#include "../include/shader_manager.h"
+#include "../include/program_cache.h"
+#include "../include/shader_cost.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Index file layout: header, entries in id order, name lookup table sorted by hash,
+// then the NUL-terminated strings the entries point into
+struct RegistryIndexHeader {
+    char magic[4];          // "STRX"
+    uint32_t version;       // Bumped whenever the layout changes
+    uint64_t sourceHash;    // Hash of the absolute directory / manifest path
+    int64_t sourceStamp;    // Its modification time when the index was built
+    uint32_t count;
+    uint32_t stringBytes;
+};
+
+struct RegistryIndexEntry {
+    uint32_t name;          // Offsets into the string table
+    uint32_t path;          // Relative to the shader directory
+    uint32_t defines;
+    float cost;
+    uint64_t nameHash;
+};
+
+struct RegistryIndexLookup {
+    uint64_t nameHash;
+    uint32_t id;
+    uint32_t reserved;
+};
+
+static const uint32_t INDEX_VERSION = 4;
+
+// Looked for inside a shader directory
+static const char* MANIFEST_NAME = "shaders.txt";
+
+static const RegistryIndexHeader* headerOf(const char* data) {
+    return reinterpret_cast<const RegistryIndexHeader*>(data);
+}
+
+static const RegistryIndexEntry* entriesOf(const char* data) {
+    return reinterpret_cast<const RegistryIndexEntry*>(data + sizeof(RegistryIndexHeader));
+}
+
+static const RegistryIndexLookup* lookupsOf(const char* data) {
+    return reinterpret_cast<const RegistryIndexLookup*>(entriesOf(data) + headerOf(data)->count);
+}
+
+static const char* stringsOf(const char* data) {
+    return reinterpret_cast<const char*>(lookupsOf(data) + headerOf(data)->count);
+}
+
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos) {
+        return "";
+    }
+    return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+// "shader2" before "shader10": runs of digits compare by value
+static bool naturalLess(const std::string& a, const std::string& b) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (std::isdigit(static_cast<unsigned char>(a[i])) && std::isdigit(static_cast<unsigned char>(b[j]))) {
+            size_t startA = i;
+            size_t startB = j;
+            while (i < a.size() && std::isdigit(static_cast<unsigned char>(a[i]))) i++;
+            while (j < b.size() && std::isdigit(static_cast<unsigned char>(b[j]))) j++;
+            std::string numberA = a.substr(startA, i - startA);
+            std::string numberB = b.substr(startB, j - startB);
+            numberA.erase(0, std::min(numberA.find_first_not_of('0'), numberA.size() - 1));
+            numberB.erase(0, std::min(numberB.find_first_not_of('0'), numberB.size() - 1));
+            if (numberA.size() != numberB.size()) {
+                return numberA.size() < numberB.size();
+            }
+            if (numberA != numberB) {
+                return numberA < numberB;
+            }
+        }
+        else {
+            if (a[i] != b[j]) {
+                return a[i] < b[j];
+            }
+            i++;
+            j++;
+        }
+    }
+    return (a.size() - i) < (b.size() - j);
+}
+
+// Read a shader file and collect the buffer passes it uses
+static void collectBufferPaths(const std::string& path, std::vector<std::string>& bufferPaths) {
+    ShaderToySource parsed = parseShaderToySource(loadShaderFromFile(path), path);
+    for (const ChannelInput& input : parsed.channels) {
+        if (input.type == ChannelInput::Buffer && input.path != path) {
+            bufferPaths.push_back(input.path);
+        }
+    }
+}
+
+// Names made of these can be given to --shader and in bench scripts without quoting
+static bool isPlainName(const std::string& name) {
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') {
+            return false;
+        }
+    }
+    return !name.empty();
+}
+
+// "NAME=VALUE NAME" as the "#define" lines that go in front of the shader code
+static std::string defineBlockOf(const std::string& defines) {
+    std::string block;
+    std::istringstream names(defines);
+    std::string define;
+    while (names >> define) {
+        size_t equals = define.find('=');
+        if (equals != std::string::npos) {
+            define = define.substr(0, equals) + " " + define.substr(equals + 1);
+        }
+        block += "#define " + define + "\n";
+    }
+    return block;
+}
+
+ShaderRegistry::ShaderRegistry() : data(nullptr), size(0), mapped(false), count(0) {
+}
+
+ShaderRegistry::~ShaderRegistry() {
+    close();
+}
+
+void ShaderRegistry::release() {
+    if (mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<char*>(data), size);
+#endif
+    }
+    memory.clear();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+void ShaderRegistry::close() {
+    release();
+    directory.clear();
+    count = 0;
+}
+
+bool ShaderRegistry::open(const std::string& source, const std::string& indexPath) {
+    close();
+
+    std::error_code error;
+    std::filesystem::path sourcePath(source);
+    bool isManifest = !std::filesystem::is_directory(sourcePath, error);
+    if (!isManifest && std::filesystem::exists(sourcePath / MANIFEST_NAME, error)) {
+        sourcePath /= MANIFEST_NAME;
+        isManifest = true;
+    }
+
+    // Adding, removing or renaming a shader file touches the directory, editing the
+    // manifest touches the manifest; either one invalidates the index
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(sourcePath, error);
+    if (error) {
+        std::cerr << "Shader directory or manifest not found: " << source << std::endl;
+        return false;
+    }
+    int64_t sourceStamp = static_cast<int64_t>(modified.time_since_epoch().count());
+    std::string absolute = std::filesystem::absolute(sourcePath, error).lexically_normal().generic_string();
+    uint64_t sourceHash = hashBytes(absolute.data(), absolute.size());
+
+    directory = isManifest ? sourcePath.parent_path().generic_string() : sourcePath.generic_string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    if (!indexPath.empty() && mapIndex(indexPath, sourceHash, sourceStamp)) {
+        count = static_cast<int>(headerOf(data)->count);
+        std::cout << "Shader registry: " << count << " shaders (index " << indexPath << ")" << std::endl;
+        return true;
+    }
+
+    std::vector<char> index;
+    if (!buildIndex(sourcePath.generic_string(), isManifest, sourceHash, sourceStamp, index)) {
+        directory.clear();
+        return false;
+    }
+
+    // Written under a temporary name and renamed, so a reader never maps half an index
+    bool written = false;
+    if (!indexPath.empty()) {
+        std::filesystem::path parent = std::filesystem::path(indexPath).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, error);
+        }
+        std::string temporary = indexPath + ".tmp";
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(index.data(), static_cast<std::streamsize>(index.size()));
+        file.close();
+        if (file) {
+            std::filesystem::rename(temporary, indexPath, error);
+            written = !error;
+        }
+        if (!written) {
+            std::filesystem::remove(temporary, error);
+            std::cerr << "Could not write the shader index " << indexPath << ", keeping it in memory" << std::endl;
+        }
+    }
+    if (!written || !mapIndex(indexPath, sourceHash, sourceStamp)) {
+        memory.swap(index);
+        data = memory.data();
+        size = memory.size();
+    }
+
+    count = static_cast<int>(headerOf(data)->count);
+    std::cout << "Shader registry: " << count << " shaders from " << sourcePath.generic_string() << std::endl;
+    return true;
+}
+
+bool ShaderRegistry::mapIndex(const std::string& indexPath, uint64_t sourceHash, int64_t sourceStamp) {
+    release();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(indexPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(RegistryIndexHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+    // The view keeps the file mapped after both handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!view) {
+        return false;
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = ::open(indexPath.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(RegistryIndexHeader))) {
+        ::close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+#endif
+
+    data = static_cast<const char*>(view);
+    mapped = true;
+    if (!validate(sourceHash, sourceStamp)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool ShaderRegistry::validate(uint64_t sourceHash, int64_t sourceStamp) const {
+    const RegistryIndexHeader* header = headerOf(data);
+    if (std::memcmp(header->magic, "STRX", 4) != 0 || header->version != INDEX_VERSION ||
+        header->sourceHash != sourceHash || header->sourceStamp != sourceStamp) {
+        return false;
+    }
+
+    // Everything the accessors touch must lie inside the file
+    size_t expected = sizeof(RegistryIndexHeader) +
+        header->count * (sizeof(RegistryIndexEntry) + sizeof(RegistryIndexLookup)) + header->stringBytes;
+    if (expected != size || header->stringBytes == 0 || data[size - 1] != '\0') {
+        return false;
+    }
+    const RegistryIndexEntry* entries = entriesOf(data);
+    const RegistryIndexLookup* lookups = lookupsOf(data);
+    for (uint32_t i = 0; i < header->count; i++) {
+        if (entries[i].name >= header->stringBytes || entries[i].path >= header->stringBytes ||
+            entries[i].defines >= header->stringBytes || lookups[i].id >= header->count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShaderRegistry::buildIndex(const std::string& source, bool isManifest, uint64_t sourceHash, int64_t sourceStamp,
+    std::vector<char>& index) const {
+    struct Record {
+        std::string name;
+        std::string path;       // Relative to the directory
+        std::string defines;
+        float cost;
+    };
+    std::vector<Record> records;
+
+    if (isManifest) {
+        std::ifstream manifest(source);
+        if (!manifest) {
+            std::cerr << "Cannot read shader manifest " << source << std::endl;
+            return false;
+        }
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(manifest, line)) {
+            lineNumber++;
+            line = trim(line);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::vector<std::string> fields;
+            std::istringstream columns(line);
+            std::string field;
+            while (std::getline(columns, field, '|')) {
+                fields.push_back(trim(field));
+            }
+            if (fields.size() < 2 || fields[1].empty()) {
+                std::cerr << source << ":" << lineNumber << ": expected name | file [| defines | cost]" << std::endl;
+                continue;
+            }
+
+            Record record;
+            record.path = fields[1];
+            record.name = fields[0].empty() ? std::filesystem::path(record.path).stem().string() : fields[0];
+            record.defines = fields.size() > 2 ? fields[2] : "";
+            record.cost = 0.0f;
+            if (!isPlainName(record.name)) {
+                std::cerr << source << ":" << lineNumber << ": name \"" << record.name << "\" needs quoting on the "
+                    << "command line and cannot be used in bench scripts; use letters, digits, - _ ." << std::endl;
+            }
+            std::error_code missing;
+            if (!std::filesystem::exists(directory + "/" + record.path, missing)) {
+                std::cerr << source << ":" << lineNumber << ": " << record.path << " not found" << std::endl;
+            }
+            if (fields.size() > 3 && !fields[3].empty()) {
+                char* end = nullptr;
+                record.cost = std::strtof(fields[3].c_str(), &end);
+                if (*end != '\0' || record.cost < 0.0f) {
+                    std::cerr << source << ":" << lineNumber << ": invalid cost " << fields[3] << std::endl;
+                    record.cost = 0.0f;
+                }
+            }
+            records.push_back(record);
+        }
+    }
+    else {
+        std::error_code error;
+        std::vector<std::string> files;
+        for (const auto& file : std::filesystem::directory_iterator(source, error)) {
+            if (file.is_regular_file(error) && file.path().extension() == ".glsl") {
+                files.push_back(file.path().filename().string());
+            }
+        }
+        std::sort(files.begin(), files.end(), naturalLess);
+
+        // Files read by other shaders through #iChannel are their buffer passes
+        std::vector<std::string> bufferPaths;
+        for (const std::string& file : files) {
+            collectBufferPaths(normalizeShaderPath(directory + "/" + file), bufferPaths);
+        }
+        std::sort(bufferPaths.begin(), bufferPaths.end());
+
+        for (size_t i = 0; i < files.size(); i++) {
+            std::string path = normalizeShaderPath(directory + "/" + files[i]);
+            if (std::binary_search(bufferPaths.begin(), bufferPaths.end(), path)) {
+                continue;
+            }
+            records.push_back(Record{ std::filesystem::path(files[i]).stem().string(), files[i], "", 0.0f });
+        }
+    }
+
+    if (records.empty()) {
+        std::cerr << "No shaders found in " << source << std::endl;
+        return false;
+    }
+
+    // Serialize
+    std::vector<char> strings;
+    auto addString = [&strings](const std::string& text) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back('\0');
+        return offset;
+    };
+
+    std::vector<RegistryIndexEntry> entries(records.size());
+    std::vector<RegistryIndexLookup> lookups(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        const Record& record = records[i];
+        RegistryIndexEntry& entry = entries[i];
+        entry.name = addString(record.name);
+        entry.path = addString(record.path);
+        entry.defines = addString(record.defines);
+        entry.cost = record.cost;
+        entry.nameHash = hashBytes(record.name.data(), record.name.size());
+
+        lookups[i].nameHash = entry.nameHash;
+        lookups[i].id = static_cast<uint32_t>(i);
+        lookups[i].reserved = 0;
+    }
+    // Equal hashes keep id order, so a duplicate name finds its first shader
+    std::sort(lookups.begin(), lookups.end(), [](const RegistryIndexLookup& a, const RegistryIndexLookup& b) {
+        return a.nameHash != b.nameHash ? a.nameHash < b.nameHash : a.id < b.id;
+    });
+
+    RegistryIndexHeader header;
+    std::memcpy(header.magic, "STRX", 4);
+    header.version = INDEX_VERSION;
+    header.sourceHash = sourceHash;
+    header.sourceStamp = sourceStamp;
+    header.count = static_cast<uint32_t>(records.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    size_t entryBytes = entries.size() * sizeof(RegistryIndexEntry);
+    size_t lookupBytes = lookups.size() * sizeof(RegistryIndexLookup);
+    index.resize(sizeof(header) + entryBytes + lookupBytes + strings.size());
+    char* out = index.data();
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), entries.data(), entryBytes);
+    std::memcpy(out + sizeof(header) + entryBytes, lookups.data(), lookupBytes);
+    std::memcpy(out + sizeof(header) + entryBytes + lookupBytes, strings.data(), strings.size());
+    return true;
+}
+
+const char* ShaderRegistry::getName(int id) const {
+    return stringsOf(data) + entriesOf(data)[id].name;
+}
+
+std::string ShaderRegistry::getPath(int id) const {
+    return normalizeShaderPath(directory + "/" + (stringsOf(data) + entriesOf(data)[id].path));
+}
+
+const char* ShaderRegistry::getDefines(int id) const {
+    return stringsOf(data) + entriesOf(data)[id].defines;
+}
+
+float ShaderRegistry::getCost(int id) const {
+    // A measured cost in the manifest beats the estimate from the source. The estimate
+    // is not kept in the index, which only notices changes to the directory / manifest.
+    float measured = entriesOf(data)[id].cost;
+    if (measured > 0.0f) {
+        return measured;
+    }
+    return estimateShaderFileCost(getPath(id), getDefineBlock(id)).getScore();
+}
+
+int ShaderRegistry::find(const std::string& nameOrNumber) const {
+    if (nameOrNumber.empty() || count == 0) {
+        return -1;
+    }
+    if (nameOrNumber.find_first_not_of("0123456789") == std::string::npos) {
+        long number = std::strtol(nameOrNumber.c_str(), nullptr, 10);
+        return (number >= 1 && number <= count) ? static_cast<int>(number - 1) : -1;
+    }
+
+    uint64_t hash = hashBytes(nameOrNumber.data(), nameOrNumber.size());
+    const RegistryIndexLookup* first = lookupsOf(data);
+    const RegistryIndexLookup* last = first + count;
+    const RegistryIndexLookup* match = std::lower_bound(first, last, hash,
+        [](const RegistryIndexLookup& lookup, uint64_t value) { return lookup.nameHash < value; });
+    for (; match != last && match->nameHash == hash; ++match) {
+        if (nameOrNumber == getName(static_cast<int>(match->id))) {
+            return static_cast<int>(match->id);
+        }
+    }
+    return -1;
+}
+
+std::string ShaderRegistry::getDefineBlock(int id) const {
+    return defineBlockOf(getDefines(id));
+}
+
+std::vector<std::string> ShaderRegistry::getNames() const {
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (int id = 0; id < count; id++) {
+        names.push_back(getName(id));
+    }
+    return names;
+}
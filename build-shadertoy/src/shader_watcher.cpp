@@ -0,0 +1,278 @@
+#include "../include/shader_watcher.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+ShaderWatcher::ShaderWatcher() : running(false) {
+#ifdef __linux__
+    inotifyFd = -1;
+    wakeFd = -1;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    stop();
+}
+
+bool ShaderWatcher::start(const std::vector<std::string>& watchPaths) {
+    stop();
+    addedPaths = watchPaths;
+
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd >= 0 && wakeFd >= 0) {
+        running = true;
+        thread = std::thread(&ShaderWatcher::runInotify, this);
+        return true;
+    }
+    std::cerr << "inotify unavailable, polling shader files instead" << std::endl;
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+        wakeFd = -1;
+    }
+#endif
+
+    running = true;
+    thread = std::thread(&ShaderWatcher::runPolling, this);
+    return true;
+}
+
+void ShaderWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeThread();
+    if (thread.joinable()) {
+        thread.join();
+    }
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+        wakeFd = -1;
+    }
+    directories.clear();
+#endif
+    paths.clear();
+    modified.clear();
+    addedPaths.clear();
+    sourceRequests.clear();
+    sources.clear();
+}
+
+void ShaderWatcher::wakeThread() {
+    wake.notify_one();
+#ifdef __linux__
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+#endif
+}
+
+void ShaderWatcher::addPaths(const std::vector<std::string>& newPaths) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        addedPaths.insert(addedPaths.end(), newPaths.begin(), newPaths.end());
+    }
+    wakeThread();
+}
+
+void ShaderWatcher::requestSources(const std::string& imagePath) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running ||
+            std::find(sourceRequests.begin(), sourceRequests.end(), imagePath) != sourceRequests.end()) {
+            return;
+        }
+        sourceRequests.push_back(imagePath);
+    }
+    wakeThread();
+}
+
+std::vector<PipelineSources> ShaderWatcher::takeSources() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<PipelineSources> taken;
+    taken.swap(sources);
+    return taken;
+}
+
+void ShaderWatcher::readRequestedSources() {
+    std::vector<std::string> requests;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.swap(sourceRequests);
+    }
+    for (const std::string& imagePath : requests) {
+        PipelineSources read;
+        readPipelineSources(imagePath, read);
+        std::lock_guard<std::mutex> lock(mutex);
+        sources.push_back(std::move(read));
+    }
+}
+
+std::vector<std::string> ShaderWatcher::takeAddedPaths() {
+    std::vector<std::string> added;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        added.swap(addedPaths);
+    }
+    std::vector<std::string> fresh;
+    for (const std::string& path : added) {
+        if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+            paths.push_back(path);
+            fresh.push_back(path);
+        }
+    }
+    return fresh;
+}
+
+std::vector<ShaderChange> ShaderWatcher::takeChanges() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ShaderChange> taken;
+    taken.swap(changes);
+    return taken;
+}
+
+#ifdef __linux__
+void ShaderWatcher::watchDirectory(const std::string& path) {
+    std::string directory = fs::path(path).parent_path().string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    bool known = std::any_of(directories.begin(), directories.end(),
+        [&directory](const std::pair<int, std::string>& entry) { return entry.second == directory; });
+    if (known) {
+        return;
+    }
+    int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        std::cerr << "Cannot watch " << directory << " for shader changes" << std::endl;
+        return;
+    }
+    directories.push_back(std::make_pair(wd, directory));
+}
+
+void ShaderWatcher::runInotify() {
+    alignas(inotify_event) char buffer[4096];
+
+    while (running) {
+        for (const std::string& path : takeAddedPaths()) {
+            watchDirectory(path);
+        }
+        readRequestedSources();
+
+        // Woken by stop(), addPaths() and requestSources(); the timeout only guards against a lost wake
+        pollfd descriptors[2] = { { inotifyFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+        if (::poll(descriptors, 2, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        if (descriptors[1].revents & POLLIN) {
+            uint64_t count;
+            ssize_t length = read(wakeFd, &count, sizeof(count));
+            (void)length;
+        }
+        if (!(descriptors[0].revents & POLLIN)) {
+            continue;
+        }
+
+        // Collect every touched path, then give the writer a moment before reading
+        pollfd& descriptor = descriptors[0];
+        std::vector<std::string> touched;
+        do {
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+                    const inotify_event* event = reinterpret_cast<inotify_event*>(p);
+                    if (event->len == 0) {
+                        continue;
+                    }
+                    for (const auto& entry : directories) {
+                        if (entry.first != event->wd) {
+                            continue;
+                        }
+                        std::string path = (fs::path(entry.second) / event->name).lexically_normal().string();
+                        if (std::find(paths.begin(), paths.end(), path) != paths.end() &&
+                            std::find(touched.begin(), touched.end(), path) == touched.end()) {
+                            touched.push_back(path);
+                        }
+                    }
+                }
+            }
+        } while (::poll(&descriptor, 1, SETTLE_MS) > 0);
+
+        for (const std::string& path : touched) {
+            readChanged(path);
+        }
+    }
+}
+#endif
+
+void ShaderWatcher::runPolling() {
+    while (running) {
+        for (const std::string& path : takeAddedPaths()) {
+            std::error_code error;
+            modified.push_back(fs::last_write_time(path, error));
+        }
+        readRequestedSources();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(POLL_INTERVAL_MS),
+                [this] { return !running || !addedPaths.empty() || !sourceRequests.empty(); });
+        }
+        for (size_t i = 0; i < paths.size() && running; i++) {
+            std::error_code error;
+            fs::file_time_type time = fs::last_write_time(paths[i], error);
+            if (error || time == modified[i]) {
+                continue;
+            }
+            modified[i] = time;
+            std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS));
+            readChanged(paths[i]);
+        }
+    }
+}
+
+void ShaderWatcher::readChanged(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    std::string code = stream.str();
+
+    // A truncated file mid-save; the final write triggers another event
+    if (code.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (ShaderChange& change : changes) {
+        if (change.path == path) {
+            change.code = code;
+            return;
+        }
+    }
+    changes.push_back(ShaderChange{ path, code });
+}
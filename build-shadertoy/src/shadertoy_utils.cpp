@@ -1,4 +1,31 @@
 #include "../include/shader_manager.h"
+#include <cctype>
+#include <filesystem>
+
+// Function to load shader code from a file
+std::string loadShaderFromFile(const std::string& filePath) {
+    std::string shaderCode;
+    std::ifstream shaderFile;
+    // Ensure ifstream objects can throw exceptions
+    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try {
+        // Open file
+        shaderFile.open(filePath);
+        std::stringstream shaderStream;
+        // Read file's buffer contents into stream
+        shaderStream << shaderFile.rdbuf();
+        // Close file
+        shaderFile.close();
+        // Convert stream into string
+        shaderCode = shaderStream.str();
+    }
+    catch (std::ifstream::failure& e) {
+        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << filePath << std::endl;
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return "";
+    }
+    return shaderCode;
+}
 
 
 // Default vertex shader for ShaderToy-style rendering
@@ -36,25 +63,24 @@ const char* shaderToyWrapper = R"(
     }
 )";
 
-// Function to render a frame with the ShaderToy shader
-void renderShaderToyFrame(
-        ShaderManager& shaderManager, 
-        GLuint quadVAO, 
-        int width, 
-        int height, 
-        float time, 
-        float deltaTime, 
-        int frame, 
-        int mouseX, 
-        int mouseY, 
-        bool mouseDown
-) {
+// Placeholder shown while a shader is still compiling: a slow dim sweep
+const char* placeholderShaderCode = R"(
+    void mainImage(out vec4 fragColor, in vec2 fragCoord)
+    {
+        vec2 uv = fragCoord / iResolution.xy;
+        float sweep = 0.5 + 0.5 * sin(iTime * 4.0 - uv.x * 6.2831853);
+        fragColor = vec4(vec3(0.06 + 0.06 * sweep), 1.0);
+    }
+)";
+
+// Function to render a frame with the ShaderToy shader. The ShaderToy globals come
+// from the shared uniform buffer, which the caller updates once per frame.
+void renderShaderToyFrame(ShaderManager& shaderManager, GLuint quadVAO) {
     // Clear the screen
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-    // Set up ShaderToy uniforms
-    shaderManager.setupShaderToyUniforms(width, height, time, deltaTime, frame, mouseX, mouseY, mouseDown);
+    shaderManager.use();
     
     // Draw the quad
     glBindVertexArray(quadVAO);
@@ -63,19 +89,38 @@ void renderShaderToyFrame(
 }
 
 
-// Create a ShaderToy-compatible fragment shader
-std::string createShaderToyFragmentShader(const std::string& shaderToyCode) {
-    std::string wrapper = R"(
+// Declarations every wrapped ShaderToy shader starts with
+static const char* shaderToyFragmentHeader = R"(
         #version 330 core
         in vec2 fragCoord;
         out vec4 fragColor;
         
-        uniform vec3 iResolution;
-        uniform float iTime;
-        uniform float iTimeDelta;
-        uniform int iFrame;
-        uniform vec4 iMouse;
+        // Shared by all programs, updated once per frame (see ShaderToyGlobalsBuffer)
+        layout(std140) uniform ShaderToyGlobals {
+            vec3 iResolution;
+            float iTime;
+            float iTimeDelta;
+            int iFrame;
+            vec4 iMouse;
+            vec4 iDate;
+        };
         
+        // Inputs declared with #iChannelN, bound to texture units 0-3
+        uniform sampler2D iChannel0;
+        uniform sampler2D iChannel1;
+        uniform sampler2D iChannel2;
+        uniform sampler2D iChannel3;
+        uniform vec3 iChannelResolution[4];
+        
+        // Pixel position of the viewport origin in the full image; non-zero only when
+        // the frame is drawn as tiles (see TiledRenderer)
+        uniform vec2 iFragCoordOffset;
+        )";
+
+// Create a ShaderToy-compatible fragment shader
+std::string createShaderToyFragmentShader(const std::string& shaderToyCode) {
+    std::string wrapper = shaderToyFragmentHeader;
+    wrapper += R"(
         // ShaderToy code
         )";
         
@@ -84,9 +129,171 @@ std::string createShaderToyFragmentShader(const std::string& shaderToyCode) {
     wrapper += R"(
         
         void main() {
-            mainImage(fragColor, fragCoord * iResolution.xy);
+            mainImage(fragColor, gl_FragCoord.xy + iFragCoordOffset);
         }
     )";
     
     return wrapper;
+}
+
+// Skip a comment starting at i, returns the index after it (i if there is none)
+static size_t skipComment(const std::string& code, size_t i) {
+    if (code.compare(i, 2, "//") == 0) {
+        size_t end = code.find('\n', i);
+        return end == std::string::npos ? code.size() : end;
+    }
+    if (code.compare(i, 2, "/*") == 0) {
+        size_t end = code.find("*/", i + 2);
+        return end == std::string::npos ? code.size() : end + 2;
+    }
+    return i;
+}
+
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+std::string instrumentLoops(const std::string& shaderToyCode, int* loopCount) {
+    std::string result;
+    result.reserve(shaderToyCode.size() + 256);
+    int loops = 0;
+
+    size_t i = 0;
+    while (i < shaderToyCode.size()) {
+        size_t afterComment = skipComment(shaderToyCode, i);
+        if (afterComment != i) {
+            result.append(shaderToyCode, i, afterComment - i);
+            i = afterComment;
+            continue;
+        }
+
+        // "for" as a whole word, followed by its header in parentheses
+        bool keyword = shaderToyCode.compare(i, 3, "for") == 0 && (i == 0 || !isIdentifierChar(shaderToyCode[i - 1])) &&
+            (i + 3 >= shaderToyCode.size() || !isIdentifierChar(shaderToyCode[i + 3]));
+        size_t open = keyword ? shaderToyCode.find_first_not_of(" \t\r\n", i + 3) : std::string::npos;
+        if (open == std::string::npos || shaderToyCode[open] != '(') {
+            result += shaderToyCode[i++];
+            continue;
+        }
+
+        // The condition sits between the two semicolons at the header's top level
+        size_t semicolons[2] = { 0, 0 };
+        int found = 0;
+        int depth = 0;
+        size_t close = open;
+        for (; close < shaderToyCode.size(); close++) {
+            char c = shaderToyCode[close];
+            if (c == '(') {
+                depth++;
+            }
+            else if (c == ')' && --depth == 0) {
+                break;
+            }
+            else if (c == ';' && depth == 1 && found < 2) {
+                semicolons[found++] = close;
+            }
+        }
+        if (close == shaderToyCode.size() || found < 2) {
+            // Not a loop header after all (or a broken one): leave it to the compiler
+            result += shaderToyCode[i++];
+            continue;
+        }
+
+        std::string condition = shaderToyCode.substr(semicolons[0] + 1, semicolons[1] - semicolons[0] - 1);
+        size_t first = condition.find_first_not_of(" \t\r\n");
+        size_t last = condition.find_last_not_of(" \t\r\n");
+        result.append(shaderToyCode, i, semicolons[0] + 1 - i);
+        if (first == std::string::npos) {
+            result += " heatCount()";
+        }
+        else {
+            result += " (" + condition.substr(first, last - first + 1) + ") && heatCount()";
+        }
+        i = semicolons[1];
+        loops++;
+    }
+
+    if (loopCount) {
+        *loopCount = loops;
+    }
+    return result;
+}
+
+// Iteration counting version of the wrapper for the heatmap mode
+std::string createHeatmapFragmentShader(const std::string& shaderToyCode, int* loopCount) {
+    std::string wrapper = shaderToyFragmentHeader;
+    wrapper += R"(
+        // Loop iterations of this pixel, counted by every instrumented loop condition
+        int heatIterations = 0;
+        bool heatCount() {
+            heatIterations++;
+            return true;
+        }
+        
+        // ShaderToy code, for loops instrumented
+        )";
+
+    wrapper += instrumentLoops(shaderToyCode, loopCount);
+
+    wrapper += R"(
+        
+        void main() {
+            vec4 color;
+            mainImage(color, gl_FragCoord.xy + iFragCoordOffset);
+            fragColor = vec4(float(heatIterations), 0.0, 0.0, 1.0);
+        }
+    )";
+
+    return wrapper;
+}
+
+std::string normalizeShaderPath(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+// Directory part of a path including the trailing separator ("" for a bare file name)
+static std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+ShaderToySource parseShaderToySource(const std::string& shaderToyCode, const std::string& filePath) {
+    ShaderToySource source;
+    std::string baseDir = directoryOf(filePath);
+
+    std::istringstream input(shaderToyCode);
+    std::string line;
+    while (std::getline(input, line)) {
+        // Directive syntax: #iChannelN "file://path" or #iChannelN "self"
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 9, "#iChannel") == 0 &&
+            start + 9 < line.size() && line[start + 9] >= '0' && line[start + 9] <= '3') {
+            int channel = line[start + 9] - '0';
+            size_t open = line.find('"', start);
+            size_t close = (open == std::string::npos) ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cerr << "Ignoring malformed directive in " << filePath << ": " << line << std::endl;
+            } else {
+                std::string value = line.substr(open + 1, close - open - 1);
+                ChannelInput& channelInput = source.channels[channel];
+                if (value == "self") {
+                    channelInput.type = ChannelInput::Buffer;
+                    channelInput.path = normalizeShaderPath(filePath);
+                } else {
+                    if (value.compare(0, 7, "file://") == 0) {
+                        value = value.substr(7);
+                    }
+                    bool isShader = value.size() > 5 && value.compare(value.size() - 5, 5, ".glsl") == 0;
+                    channelInput.type = isShader ? ChannelInput::Buffer : ChannelInput::Texture;
+                    channelInput.path = normalizeShaderPath(baseDir + value);
+                }
+            }
+            // Keep an empty line so compiler error line numbers still match the file
+            source.code += "\n";
+            continue;
+        }
+        source.code += line;
+        source.code += "\n";
+    }
+    return source;
 }
\ No newline at end of file
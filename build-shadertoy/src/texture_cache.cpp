@@ -0,0 +1,116 @@
+#include "../include/texture_cache.h"
+#include "../include/program_cache.h"
+#include "../../SDL/SDL_image.h"
+#include <cstring>
+
+TextureCache::TextureCache() {
+}
+
+TextureCache::~TextureCache() {
+    destroy();
+}
+
+// Read the texture back and compare, only done when the content hashes match
+static bool samePixels(const CachedTexture& texture, int width, int height, const std::vector<unsigned char>& pixels) {
+    if (texture.width != width || texture.height != height) {
+        return false;
+    }
+    std::vector<unsigned char> stored(pixels.size());
+    glBindTexture(GL_TEXTURE_2D, texture.texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, stored.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return stored == pixels;
+}
+
+bool decodeImage(const std::string& path, DecodedImage& image) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (!loaded) {
+        std::cerr << "Unable to load image " << path << "! SDL_image Error: " << IMG_GetError() << std::endl;
+        return false;
+    }
+
+    // Normalise to tightly packed RGBA bytes whatever the file format was
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!surface) {
+        std::cerr << "Unable to convert image " << path << "! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // Flip so the image is upright for ShaderToy's bottom-left texture origin
+    size_t rowSize = static_cast<size_t>(surface->w) * 4;
+    image.pixels.resize(rowSize * surface->h);
+    const unsigned char* source = static_cast<const unsigned char*>(surface->pixels);
+    for (int y = 0; y < surface->h; y++) {
+        memcpy(&image.pixels[(surface->h - 1 - y) * rowSize], source + y * surface->pitch, rowSize);
+    }
+    image.width = surface->w;
+    image.height = surface->h;
+    SDL_FreeSurface(surface);
+    return true;
+}
+
+CachedTexture TextureCache::acquire(const std::string& path, const DecodedImage* decoded) {
+    auto known = byPath.find(path);
+    if (known != byPath.end()) {
+        return known->second;
+    }
+
+    DecodedImage read;
+    if (!decoded) {
+        if (!decodeImage(path, read)) {
+            return CachedTexture();
+        }
+        decoded = &read;
+    }
+    if (decoded->pixels.empty()) {
+        return CachedTexture();
+    }
+    const std::vector<unsigned char>& pixels = decoded->pixels;
+
+    CachedTexture entry;
+    entry.width = decoded->width;
+    entry.height = decoded->height;
+
+    // The same pixels under another file name reuse the existing texture. A matching
+    // hash is confirmed against the texture's own pixels before sharing it.
+    uint64_t contentKey = hashBytes(pixels.data(), pixels.size());
+    contentKey = hashBytes(&entry.width, sizeof(entry.width), contentKey);
+    contentKey = hashBytes(&entry.height, sizeof(entry.height), contentKey);
+    auto candidates = byContent.equal_range(contentKey);
+    for (auto identical = candidates.first; identical != candidates.second; ++identical) {
+        if (samePixels(identical->second, entry.width, entry.height, pixels)) {
+            byPath[path] = identical->second;
+            return identical->second;
+        }
+    }
+
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, entry.width, entry.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // ShaderToy defaults for image inputs: mipmapped and repeating
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    std::cout << "Loaded texture " << path << " (" << entry.width << "x" << entry.height << ")" << std::endl;
+    byContent.insert(std::make_pair(contentKey, entry));
+    byPath[path] = entry;
+    return entry;
+}
+
+void TextureCache::destroy() {
+    for (auto& item : byContent) {
+        glDeleteTextures(1, &item.second.texture);
+    }
+    byContent.clear();
+    byPath.clear();
+}
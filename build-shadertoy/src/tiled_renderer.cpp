@@ -0,0 +1,175 @@
+#include "../include/tiled_renderer.h"
+#include <algorithm>
+#include <cmath>
+
+// Tiles never get smaller than this, however slow the shader
+static const int MIN_TILE = 32;
+
+// Tiles never get larger than this, even on GPUs that accept bigger viewports
+static const int MAX_TILE = 4096;
+
+// Tiles are sized for this fraction of the budget; neighbouring regions can cost more
+static const double BUDGET_MARGIN = 0.75;
+
+TiledRenderer::TiledRenderer()
+    : firstTile(256), maxTile(MAX_TILE), budgetMs(100.0), tiles(0), overBudget(0), slowestMs(0.0) {
+}
+
+TiledRenderer::~TiledRenderer() {
+    destroy();
+}
+
+void TiledRenderer::init(int tileSize, double budget) {
+    destroy();
+
+    GLint viewportDims[2] = { 0, 0 };
+    GLint textureSize = 0;
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewportDims);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &textureSize);
+    maxTile = std::min({ MAX_TILE, static_cast<int>(viewportDims[0]), static_cast<int>(viewportDims[1]),
+        static_cast<int>(textureSize) });
+    maxTile = std::max(maxTile, MIN_TILE);
+
+    firstTile = std::clamp(tileSize, MIN_TILE, maxTile);
+    budgetMs = budget;
+}
+
+void TiledRenderer::destroy() {
+    profiler.destroy();
+    tileTarget.destroy();
+    pixelsPerMs.clear();
+    tiles = 0;
+    overBudget = 0;
+    slowestMs = 0.0;
+}
+
+bool TiledRenderer::isRequired(int width, int height) {
+    GLint viewportDims[2] = { 0, 0 };
+    GLint textureSize = 0;
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewportDims);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &textureSize);
+    return width > std::min(viewportDims[0], textureSize) || height > std::min(viewportDims[1], textureSize);
+}
+
+int TiledRenderer::tileEdge(int pass) const {
+    if (pixelsPerMs[pass] <= 0.0) {
+        return firstTile;
+    }
+    int edge = static_cast<int>(std::sqrt(pixelsPerMs[pass] * budgetMs * BUDGET_MARGIN));
+    return std::clamp(edge, MIN_TILE, maxTile);
+}
+
+int TiledRenderer::tileWidth(int pass, int rowHeight) const {
+    if (pixelsPerMs[pass] <= 0.0) {
+        return firstTile;
+    }
+    // The row height is fixed, so the width carries the whole adjustment
+    double width = pixelsPerMs[pass] * budgetMs * BUDGET_MARGIN / rowHeight;
+    return static_cast<int>(std::clamp(width, static_cast<double>(MIN_TILE), static_cast<double>(maxTile)));
+}
+
+bool TiledRenderer::render(MultipassPipeline& pipeline, GLuint quadVAO, int width, int height,
+    std::vector<unsigned char>* pixels) {
+    int passCount = pipeline.getPassCount();
+    if (static_cast<int>(pixelsPerMs.size()) != passCount) {
+        pixelsPerMs.assign(passCount, 0.0);
+        profiler.init(passCount, 4);
+    }
+
+    // Buffer passes are sampled anywhere, so they still need full-size textures
+    if (pipeline.getBufferCount() > 0) {
+        GLint textureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &textureSize);
+        if (width > textureSize || height > textureSize) {
+            std::cerr << "Buffer passes cannot be " << width << "x" << height << ", the GPU allows textures up to "
+                << textureSize << "x" << textureSize << std::endl;
+            return false;
+        }
+    }
+    pipeline.prepareTiles(width, height);
+
+    if (pixels) {
+        pixels->resize(static_cast<size_t>(width) * height * 4);
+    }
+    int lastPass = pixels ? passCount : passCount - 1;
+
+    for (int pass = 0; pass < lastPass; pass++) {
+        // Rows of equal height; within a row every tile is sized from the ones before it
+        for (int y = 0; y < height;) {
+            int rowHeight = std::min(tileEdge(pass), height - y);
+            for (int x = 0; x < width;) {
+                int w = std::min(tileWidth(pass, rowHeight), width - x);
+                double ms = drawTile(pipeline, pass, quadVAO, x, y, w, rowHeight, width, pixels);
+
+                // Slower regions take effect at once, faster ones only half way
+                double measured = static_cast<double>(w) * rowHeight / std::max(ms, 0.01);
+                double& estimate = pixelsPerMs[pass];
+                estimate = (estimate <= 0.0 || measured < estimate) ? measured : 0.5 * (estimate + measured);
+
+                tiles++;
+                slowestMs = std::max(slowestMs, ms);
+                if (ms > budgetMs) {
+                    overBudget++;
+                }
+                x += w;
+            }
+            y += rowHeight;
+        }
+        pipeline.endPass(pass);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+double TiledRenderer::drawTile(MultipassPipeline& pipeline, int pass, GLuint quadVAO, int x, int y, int w, int h,
+    int width, std::vector<unsigned char>* pixels) {
+    bool image = pass == pipeline.getPassCount() - 1;
+    if (image && (tileTarget.getWidth() < w || tileTarget.getHeight() < h)) {
+        tileTarget.resize(std::max(tileTarget.getWidth(), w), std::max(tileTarget.getHeight(), h));
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    profiler.begin(pass);
+    pipeline.drawTile(pass, quadVAO, x, y, w, h, tileTarget.getFramebuffer());
+    profiler.end();
+
+    if (image) {
+        // Rows of the full image are width pixels apart; the read waits for the tile
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, tileTarget.getFramebuffer());
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_PACK_ROW_LENGTH, width);
+        unsigned char* destination = pixels->data() + (static_cast<size_t>(y) * width + x) * 4;
+        glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, destination);
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+    else {
+        // One tile per submission: the next one is only queued when this one is done
+        glFinish();
+    }
+
+    // Without timestamp queries the wall time is the (pessimistic) fallback
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    int tag = 0;
+    double gpuMs = 0.0;
+    while (profiler.fetch(tag, gpuMs)) {
+        ms = gpuMs;
+    }
+    return ms;
+}
+
+void TiledRenderer::printStats() const {
+    if (tiles == 0) {
+        return;
+    }
+    std::cout << "Tiles: " << tiles << " drawn, " << overBudget << " over the " << budgetMs << " ms budget, slowest "
+        << slowestMs << " ms" << std::endl;
+    for (int pass = 0; pass < static_cast<int>(pixelsPerMs.size()); pass++) {
+        GpuStats stats = profiler.getStats(pass);
+        bool image = pass == static_cast<int>(pixelsPerMs.size()) - 1;
+        std::cout << "  " << (image ? std::string("image") : "buffer " + std::to_string(pass)) << ": tile edge "
+            << tileEdge(pass) << ", GPU per tile mean " << stats.mean << " ms, max " << stats.max << " ms" << std::endl;
+    }
+}
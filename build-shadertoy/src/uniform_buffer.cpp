@@ -0,0 +1,132 @@
+#include "../include/uniform_buffer.h"
+#include <cstring>
+
+static_assert(sizeof(ShaderToyGlobals) == 64, "ShaderToyGlobals must match the std140 block layout");
+
+ShaderToyGlobals makeShaderToyGlobals(int width, int height, double time, double deltaTime, int frame,
+    int mouseX, int mouseY, bool mouseDown, const float date[4]) {
+    ShaderToyGlobals globals = {};
+    globals.iResolution[0] = static_cast<float>(width);
+    globals.iResolution[1] = static_cast<float>(height);
+    globals.iResolution[2] = 1.0f;
+    globals.iTime = static_cast<float>(time);
+    globals.iTimeDelta = static_cast<float>(deltaTime);
+    globals.iFrame = frame;
+    for (int i = 0; i < 4; i++) {
+        globals.iDate[i] = date[i];
+    }
+
+    // Mouse position and click state
+    float mx = static_cast<float>(mouseX);
+    float my = static_cast<float>(height - mouseY); // Invert Y for ShaderToy compatibility
+    globals.iMouse[0] = mx;
+    globals.iMouse[1] = my;
+    globals.iMouse[2] = mouseDown ? mx : 0.0f;
+    globals.iMouse[3] = mouseDown ? my : 0.0f;
+    return globals;
+}
+
+ShaderToyGlobalsBuffer::ShaderToyGlobalsBuffer()
+    : buffer(0), slotSize(0), slot(0), persistent(false), mapped(nullptr) {
+    for (int i = 0; i < RING_SIZE; i++) {
+        fences[i] = 0;
+    }
+}
+
+ShaderToyGlobalsBuffer::~ShaderToyGlobalsBuffer() {
+    destroy();
+}
+
+bool ShaderToyGlobalsBuffer::init() {
+    destroy();
+
+    // Each slot must start at a multiple of the bind offset alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    slotSize = ((sizeof(ShaderToyGlobals) + alignment - 1) / alignment) * alignment;
+    slot = RING_SIZE - 1;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, slotSize * RING_SIZE, NULL, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, slotSize * RING_SIZE, flags));
+        if (!mapped) {
+            std::cerr << "Persistent mapping of the globals buffer failed!" << std::endl;
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            destroy();
+            return false;
+        }
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, slotSize * RING_SIZE, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return true;
+}
+
+void ShaderToyGlobalsBuffer::destroy() {
+    for (int i = 0; i < RING_SIZE; i++) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    if (buffer != 0) {
+        if (mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    persistent = false;
+}
+
+void ShaderToyGlobalsBuffer::update(const ShaderToyGlobals& globals) {
+    if (buffer == 0) {
+        return;
+    }
+
+    // Every draw that reads the previous slot was issued before this call, so a fence
+    // placed now tells when that slot may be written again
+    if (persistent) {
+        if (fences[slot]) {
+            glDeleteSync(fences[slot]);
+        }
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    slot = (slot + 1) % RING_SIZE;
+    GLintptr offset = slot * slotSize;
+
+    if (persistent) {
+        // Normally signalled long ago, only waits when the GPU is RING_SIZE frames behind
+        if (fences[slot]) {
+            glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[slot]);
+            fences[slot] = 0;
+        }
+        memcpy(mapped + offset, &globals, sizeof(globals));
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (slot == 0) {
+            // Orphan the storage when the ring wraps instead of waiting for the GPU
+            glBufferData(GL_UNIFORM_BUFFER, slotSize * RING_SIZE, NULL, GL_STREAM_DRAW);
+        }
+        void* target = glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(globals),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (target) {
+            memcpy(target, &globals, sizeof(globals));
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, SHADERTOY_GLOBALS_BINDING, buffer, offset, sizeof(globals));
+}